@@ -0,0 +1,110 @@
+#ifndef AST_H
+#define AST_H
+
+#include <stddef.h>
+
+typedef enum {
+    EXPR_NUMBER,
+    EXPR_IDENTIFIER,
+    EXPR_NEGATE,
+    EXPR_BINARY
+} ExprKind;
+
+typedef enum {
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_LT,
+    OP_GT,
+    OP_LE,
+    OP_GE,
+    OP_EQ,
+    OP_NE
+} BinaryOp;
+
+/* Expression nodes live in one flat array and refer to their operands by
+ * index, so a parsed expression is a contiguous post-order run of nodes. */
+typedef struct {
+    unsigned char kind;   /* ExprKind */
+    unsigned char op;     /* BinaryOp, for EXPR_BINARY */
+    int line;
+    int column;
+    int slot;             /* EXPR_IDENTIFIER: variable slot, set by semantic_check */
+    union {
+        long long number;             /* EXPR_NUMBER */
+        int name;                     /* EXPR_IDENTIFIER: offset into names */
+        int operand;                  /* EXPR_NEGATE */
+        struct { int lhs, rhs; } bin; /* EXPR_BINARY */
+    } as;
+} ExprNode;
+
+typedef enum {
+    STMT_DECL,
+    STMT_ASSIGN,
+    STMT_PRINT,
+    STMT_IF,
+    STMT_ELSE,
+    STMT_WHILE
+} StmtKind;
+
+/* Statements are stored in pre-order: the body of an if/else/while follows
+ * its node directly and `end` is the index one past the body, so siblings
+ * are reached by jumping to `end` and no child lists are needed. An if
+ * with an else branch spans both bodies; `else_branch` is the index of its
+ * STMT_ELSE node, whose own body runs to the same `end`. */
+typedef struct {
+    unsigned char kind;   /* StmtKind */
+    int line;
+    int column;
+    int name;             /* STMT_DECL, STMT_ASSIGN: offset into names */
+    int slot;             /* STMT_DECL, STMT_ASSIGN: variable slot, set by semantic_check */
+    int expr;             /* value or condition, -1 if none */
+    int end;
+    int else_branch;      /* STMT_IF: index of STMT_ELSE, or -1 */
+} StmtNode;
+
+/* A top-level function; its body is the statement range [body_start, body_end) */
+typedef struct {
+    int name;             /* offset into names */
+    int line;
+    int column;
+    int body_start;
+    int body_end;
+} FunctionNode;
+
+typedef struct {
+    FunctionNode *functions;
+    int function_count;
+    int function_capacity;
+
+    StmtNode *stmts;
+    int stmt_count;
+    int stmt_capacity;
+
+    ExprNode *exprs;
+    int expr_count;
+    int expr_capacity;
+
+    char *names;          /* NUL-separated identifier spellings */
+    size_t names_len;
+    size_t names_capacity;
+} Ast;
+
+void ast_init(Ast *ast);
+void ast_free(Ast *ast);
+/* Both keep the storage for reuse. ast_clear() drops everything;
+ * ast_drop_body() keeps only the last function, whose body then restarts
+ * at statement 0 (a streamed parse holding one function at a time). */
+void ast_clear(Ast *ast);
+void ast_drop_body(Ast *ast);
+int ast_add_function(Ast *ast, const char *name, int line, int column);
+int ast_add_stmt(Ast *ast, StmtKind kind, int line, int column);
+int ast_add_expr(Ast *ast, const ExprNode *node);
+int ast_add_name(Ast *ast, const char *name);
+const char *ast_name(const Ast *ast, int name);
+/* Move everything in `src` to the end of `dst`, rebasing node indices */
+void ast_append(Ast *dst, const Ast *src);
+const char *binary_op_to_string(BinaryOp op);
+
+#endif /* AST_H */
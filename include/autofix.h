@@ -1,25 +1,79 @@
 #ifndef AUTOFIX_H
 #define AUTOFIX_H
 
+#include <stddef.h>
 #include "config.h"
 #include "lexer.h"
+#include "error_handler.h"
 
 typedef enum {
     AUTOFIX_NOT_APPLIED,
     AUTOFIX_APPLIED
 } AutofixResult;
 
-AutofixResult autofix_try(const char *error_type,
-                         const char *expected_type,
-                         const char *expected_lexeme,
-                         const Token *actual_token);
-
-int is_safe_autofix_error(const char *expected_token, const char *actual_token);
-void autofix_reset_count(void);
-int autofix_limit_reached(void);
-void autofix_record_applied(void);
-void autofix_reset_lines(void);
-int autofix_already_applied_on_line(int line);
-void autofix_record_line(int line);
+/* A fix the repair engine can make at an error point: insert one symbol
+ * in front of the offending token, or drop the offending token. */
+typedef enum {
+    REPAIR_INSERT,
+    REPAIR_DELETE
+} RepairKind;
+
+typedef struct {
+    RepairKind kind;
+    char lexeme[2];       /* symbol inserted by REPAIR_INSERT */
+} RepairCandidate;
+
+/*
+ * Lookahead supplied by the parser. `run` parses on quietly from a copy of
+ * the parser state at the error, with the candidate spliced in at the
+ * error token, and returns how many tokens past the error it got through,
+ * REPAIR_WINDOW meaning the whole window (or a cleanly closed function).
+ *
+ * The statement read before the error is not parsed again, so one repair
+ * costs O(candidates * REPAIR_WINDOW) tokens, with at most two candidates,
+ * plus copying the stacks of an expression the error interrupted.
+ */
+typedef struct {
+    int (*run)(void *arg, const RepairCandidate *candidate);
+    void *arg;
+} RepairTrial;
+
+/* Per-compile auto-fix bookkeeping. Lines that already received a fix are
+ * kept in a growable bitmap indexed by line number, so lookup and insert
+ * are O(1) no matter how many fixes a large file produces. */
+typedef struct {
+    int applied_count;
+    int max_per_run;
+    unsigned char *line_bits;
+    size_t line_bits_size;
+} AutofixContext;
+
+/*
+ * Pick an in-memory repair for an error whose code has a repair symbol.
+ * With a trial, every candidate (insert the symbol, delete the offending
+ * token) is scored by bounded lookahead and the best one that reaches
+ * REPAIR_MIN_PROGRESS wins, insertion first on ties. Without one (input
+ * that cannot be re-read) the symbol is inserted unscored, which the
+ * caller must have vetted with is_safe_autofix_error().
+ */
+AutofixResult autofix_try(ErrorCode code,
+                         const Token *actual_token,
+                         const RepairTrial *trial,
+                         RepairCandidate *repair);
+
+/* Whether `code` may be fixed without lookahead: only a missing ';'
+ * before an identifier or '}' */
+int is_safe_autofix_error(ErrorCode code, const Token *actual_token);
+
+void autofix_context_init(AutofixContext *ctx);
+void autofix_context_free(AutofixContext *ctx);
+void autofix_set_max_per_run(AutofixContext *ctx, int max_per_run);
+
+void autofix_reset_count(AutofixContext *ctx);
+int autofix_limit_reached(const AutofixContext *ctx);
+void autofix_record_applied(AutofixContext *ctx);
+void autofix_reset_lines(AutofixContext *ctx);
+int autofix_already_applied_on_line(const AutofixContext *ctx, int line);
+void autofix_record_line(AutofixContext *ctx, int line);
 
 #endif /* AUTOFIX_H */
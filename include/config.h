@@ -2,7 +2,55 @@
 #define CONFIG_H
 
 #define HABIT_THRESHOLD 3
+
+/* Default auto-fix budget per run; override with --max-autofix N */
 #define MAX_AUTOFIX_PER_RUN 2
-#define MAX_AUTOFIX_LINES 100
+
+/* Repair engine: a candidate fix is tried by parsing on from the error for
+ * up to REPAIR_WINDOW tokens and must get at least REPAIR_MIN_PROGRESS of
+ * them through */
+#define REPAIR_WINDOW 12
+#define REPAIR_MIN_PROGRESS 2
+
+/* Streamed input (hasc -): the statements of a function are checked and
+ * dropped in runs of at least this many, so memory stays bounded however
+ * long the input or any one function is */
+#define PARSE_STREAM_CHUNK 4096
+
+/* Batch loading (--batch): read ahead up to LOADER_PREFETCH_FILES files
+ * (override with --prefetch N, 0 = no read-ahead) while holding at most
+ * LOADER_INFLIGHT_BYTES of file data. The thread backend uses
+ * LOADER_IO_THREADS readers; the io_uring one keeps at most
+ * 1/LOADER_FD_SHARE of RLIMIT_NOFILE files open at once. */
+#define LOADER_PREFETCH_FILES 32
+#define LOADER_MAX_PREFETCH 4096
+#define LOADER_INFLIGHT_BYTES (64u << 20)
+#define LOADER_IO_THREADS 4
+#define LOADER_FD_SHARE 4
+
+/* Approximate habit counts (--sketch): total size of a new sketch file,
+ * counter rows and Bloom probes. See habit_sketch.h for the error bounds
+ * these give. */
+#define HABIT_SKETCH_BYTES (1u << 20)
+#define HABIT_SKETCH_MIN_BYTES 4096u
+#define HABIT_SKETCH_MAX_BYTES (1u << 30)
+#define HABIT_SKETCH_DEPTH 4
+#define HABIT_SKETCH_HASHES 4
+
+/* Habit profiles (--user): how many recently used profiles stay cached,
+ * how many bytes of new records a profile holds before writing them
+ * back to its log, and how much log may pile up past its saved counts
+ * before they are rewritten */
+#define PROFILE_CACHE_SIZE 64
+#define PROFILE_WRITEBACK_BYTES (64u << 10)
+#define PROFILE_INDEX_TAIL_BYTES (256L << 10)
+
+/* --run: a while loop is compiled to bytecode once it has taken this many
+ * back-edges in the interpreter; short loops never pay for compiling */
+#define EXEC_TIER_UP_BACKEDGES 1000
+/* Loop iterations before a run is stopped (--max-steps) */
+#define EXEC_MAX_STEPS 100000000LL
+/* Minimum time each --bench configuration is measured for */
+#define EXEC_BENCH_MS 200.0
 
 #endif
@@ -0,0 +1,53 @@
+#ifndef ERROR_HANDLER_H
+#define ERROR_HANDLER_H
+
+/*
+ * Every diagnostic the compiler can log, in one table:
+ *   X(code, kind, expected_type, expected_lexeme, repair, message)
+ * `repair` is the symbol the repair engine may insert for it, or 0.
+ * The enum values are written to the habit profile, so new codes are
+ * only ever appended.
+ */
+#define ERROR_CODE_LIST(X) \
+    X(E_MISSING_SEMICOLON,    "syntax_error",   "TOKEN_SYMBOL",     ";",   ';', "Missing semicolon") \
+    X(E_MISSING_BRACE,        "syntax_error",   "TOKEN_SYMBOL",     "} or ;", '}', "Missing closing brace") \
+    X(E_MISSING_LBRACE,       "syntax_error",   "TOKEN_SYMBOL",     "{",   '{', "Missing opening brace") \
+    X(E_MISSING_LPAREN,       "syntax_error",   "TOKEN_SYMBOL",     "(",   '(', "Missing opening parenthesis") \
+    X(E_MISSING_RPAREN,       "syntax_error",   "TOKEN_SYMBOL",     ")",   ')', "Missing closing parenthesis") \
+    X(E_MISSING_ASSIGN,       "syntax_error",   "TOKEN_SYMBOL",     "=",   0,   "Missing '=' in assignment") \
+    X(E_UNTERMINATED_STMT,    "syntax_error",   "TOKEN_SYMBOL",     "; or }", 0, "Statement not terminated") \
+    X(E_EXPECTED_INT,         "syntax_error",   "TOKEN_KEYWORD",    "int", 0,   "Expected 'int'") \
+    X(E_EXPECTED_FUNCTION_NAME, "syntax_error", "TOKEN_IDENTIFIER", "<function name>", 0, "Expected a function name") \
+    X(E_EXPECTED_IDENTIFIER,  "syntax_error",   "TOKEN_IDENTIFIER", "<identifier>", 0, "Expected an identifier") \
+    X(E_EXPECTED_OPERAND,     "syntax_error",   "TOKEN_IDENTIFIER or TOKEN_NUMBER", "<identifier or number>", 0, "Expected an operand") \
+    X(E_UNDECLARED_VARIABLE,  "semantic_error", "TOKEN_IDENTIFIER", "<declared identifier>", 0, "Undeclared variable") \
+    X(E_REDECLARED_VARIABLE,  "semantic_error", "TOKEN_IDENTIFIER", "<new identifier>", 0, "Redeclared variable") \
+    X(E_REDEFINED_FUNCTION,   "semantic_error", "TOKEN_IDENTIFIER", "<new function name>", 0, "Redefined function") \
+    X(E_EXPECTED_KEYWORD,     "syntax_error",   "TOKEN_KEYWORD",    "<keyword>", 0, "Expected a keyword") \
+    X(E_EXPECTED_NUMBER,      "syntax_error",   "TOKEN_NUMBER",     "<number>", 0, "Expected a number") \
+    X(E_EXPECTED_SYMBOL,      "syntax_error",   "TOKEN_SYMBOL",     "<symbol>", 0, "Expected a symbol")
+
+typedef enum {
+#define X(code, kind, expected_type, expected_lexeme, repair, message) code,
+    ERROR_CODE_LIST(X)
+#undef X
+    ERROR_CODE_COUNT
+} ErrorCode;
+
+const char *error_code_name(ErrorCode code);
+const char *error_kind(ErrorCode code);
+const char *error_expected_type(ErrorCode code);
+const char *error_expected_lexeme(ErrorCode code);
+const char *error_message(ErrorCode code);
+/* Symbol the repair engine may insert, or 0 if the error is not repairable */
+char error_repair_symbol(ErrorCode code);
+
+/* Code for a name such as "E_MISSING_SEMICOLON", or -1 */
+int error_code_from_name(const char *name);
+/* Code for the string triple used by profile records before codes, or -1.
+ * Syntax errors whose expectation has no code of its own any more (such as
+ * 'main' or a '}' closing an if body) get the generic code for the
+ * expected token type. */
+int error_code_from_fields(const char *kind, const char *expected_type, const char *expected_lexeme);
+
+#endif /* ERROR_HANDLER_H */
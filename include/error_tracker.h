@@ -2,10 +2,31 @@
 #define ERROR_TRACKER_H
 
 #include "lexer.h"
+#include "error_handler.h"
 
-void error_tracker_log(const char *error_type,
-                       const char *expected_type,
-                       const char *expected_lexeme,
-                       const Token *actual_token);
+/*
+ * One line of the habit profile:
+ *   code|actual_type|line|column|actual_lexeme|file
+ * with the codes and token types as numbers. The first five fields are
+ * the mistake's fingerprint; the source file is only for --habits.
+ */
+typedef struct {
+    ErrorCode code;
+    TokenType actual_type;
+    int line;
+    int column;
+    const char *actual_lexeme;   /* points into the parsed line */
+    const char *file;            /* points into the parsed line, may be "" */
+} ErrorRecord;
+
+/* Source file name recorded with each logged error (for --habits) */
+void error_tracker_set_source(const char *name);
+
+void error_tracker_log(ErrorCode code, const Token *actual_token);
+
+/* Parse one profile line (without its newline) in place. Lines in the
+ * older all-strings format are understood too. Returns 0 for anything
+ * that is not a record. */
+int error_record_parse(char *line, ErrorRecord *record);
 
 #endif /* ERROR_TRACKER_H */
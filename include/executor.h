@@ -0,0 +1,57 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <stdio.h>
+#include "ast.h"
+
+/*
+ * Runs a parsed and checked program (--run), starting at main() or, if
+ * there is none, the first function.
+ *
+ * Statements start out in a tree-walking interpreter over the flat Ast,
+ * which needs no preparation at all. Every while loop counts its
+ * back-edges; once a loop has taken `tier_up` of them it is compiled to
+ * bytecode and the rest of that loop, and every later entry to it, runs
+ * there. Variables live in one slot array shared by both tiers, so the
+ * switch happens between two iterations without moving any state.
+ *
+ * The bytecode fuses the common loop shapes into single instructions:
+ * compare-slot-with-slot/constant-and-branch, x = y op z on slots and
+ * constants, x = y + k, and a rotated loop whose back-edge is one
+ * compare-and-jump.
+ *
+ * Integers are 64-bit and wrap; division by zero stops the program with
+ * a runtime error. Variables start at 0.
+ */
+typedef struct {
+    long tier_up;         /* back-edges before a loop is compiled; 0 = on
+                             entry, negative = never */
+    long long max_steps;  /* loop iterations before giving up, 0 = no limit */
+    int quiet;            /* discard print() output (benchmarks) */
+} ExecOptions;
+
+typedef struct {
+    long long ops;             /* statements run, counting each if/while test */
+    long long back_edges;      /* in both tiers */
+    long long compiled_back_edges;
+    int loops_compiled;
+    double compile_ms;
+} ExecStats;
+
+typedef enum {
+    EXEC_OK,
+    EXEC_RUNTIME_ERROR,
+    EXEC_STEP_LIMIT
+} ExecResult;
+
+void exec_options_init(ExecOptions *options);
+
+/* `slot_count` is the number of variable slots semantic_check() assigned */
+ExecResult execute_program(const Ast *ast, int slot_count, const ExecOptions *options,
+                           ExecStats *stats);
+
+/* Run the program interpreter-only, tiered and bytecode-only, printing
+ * first-run latency and steady-state ops/sec for each (--bench) */
+void exec_benchmark(const Ast *ast, int slot_count, const ExecOptions *options, FILE *out);
+
+#endif /* EXECUTOR_H */
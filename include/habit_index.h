@@ -0,0 +1,60 @@
+#ifndef HABIT_INDEX_H
+#define HABIT_INDEX_H
+
+#include <stdio.h>
+#include "symbol_table.h"
+#include "error_tracker.h"
+
+/* Counts keyed by interned strings; the symbol table doubles as a
+ * general-purpose interner, so a key's intern id indexes `counts`. */
+typedef struct {
+    SymbolTable keys;
+    unsigned long *counts;
+    int capacity;
+} Tally;
+
+void tally_init(Tally *tally);
+void tally_free(Tally *tally);
+void tally_add(Tally *tally, const char *key, unsigned long amount);
+/* Count of `key`, 0 if it was never added */
+unsigned long tally_count(Tally *tally, const char *key);
+const char *tally_key(const Tally *tally, int id);
+int tally_size(const Tally *tally);
+
+/*
+ * Aggregated history of one profile (its PROFILE_INDEX file): how often
+ * each logged record occurred, up to log_offset bytes into the log.
+ *
+ *   HASCIDX 3 <log offset> <events>
+ *   M <count> code|type|line|column|lexeme|file
+ *
+ * Loading it costs one line per distinct mistake, so only the log
+ * appended since it was written has to be read. Both --habits and the
+ * profile cache keep it up to date.
+ */
+typedef struct {
+    Tally mistakes;       /* code|type|line|column|lexeme|file, as logged */
+    unsigned long events;
+    long log_offset;      /* bytes of the log already folded in */
+} HabitIndex;
+
+/* Called for every record folded into an index, with its count */
+typedef void (*HabitRecordFn)(void *arg, const ErrorRecord *record, unsigned long amount);
+
+void habit_index_init(HabitIndex *index);
+void habit_index_free(HabitIndex *index);
+void habit_index_add(HabitIndex *index, const ErrorRecord *record, unsigned long amount);
+
+/* Load the index at `path`, passing each mistake to `each` (may be NULL)
+ * as it goes. Returns 0, leaving `index` empty, if there is
+ * none, it is in another format, or it covers more than log_size bytes
+ * (the log was reset since). */
+int habit_index_load(HabitIndex *index, const char *path, long log_size,
+                     HabitRecordFn each, void *arg);
+/* Fold every complete log line after index->log_offset, passing each
+ * record to `each` (may be NULL) */
+void habit_index_read_log(HabitIndex *index, FILE *log, HabitRecordFn each, void *arg);
+/* Rewrite the index at `path`; a failed write just loses the cache */
+void habit_index_save(const HabitIndex *index, const char *path);
+
+#endif /* HABIT_INDEX_H */
@@ -0,0 +1,63 @@
+#ifndef HABIT_SKETCH_H
+#define HABIT_SKETCH_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "lexer.h"
+#include "error_handler.h"
+
+#define SKETCH_VERSION 1
+
+/*
+ * Optional bounded-memory habit counts (--sketch). Instead of scanning the
+ * whole history log, threshold_check() asks a count-min sketch kept in
+ * the profile's PROFILE_SKETCH file, fronted by a Bloom filter that is held
+ * in memory.
+ *
+ * Layout, all integers little-endian:
+ *   header    "HASCCMS\0", u32 version, u32 width, u32 depth,
+ *             u32 bloom_bytes, u64 events
+ *   bloom     bloom_bytes of filter bits (HABIT_SKETCH_HASHES probes each)
+ *   counters  depth rows of width u32 counters, saturating
+ *
+ * The file size is fixed when it is created (HABIT_SKETCH_BYTES or
+ * --sketch=BYTES); an existing sketch keeps its own geometry until
+ * --reset. A new sketch is seeded from the existing history log; while
+ * the sketch is in use, mistakes go to it instead of the log, so the log
+ * (and --habits) no longer grows with them.
+ *
+ * Error bounds, for N logged events, w = width and d = depth:
+ *   - an estimate is never below the exact count: Bloom filters have no
+ *     false negatives, counters only grow and saturate instead of
+ *     wrapping, and the estimate is the minimum over rows that each
+ *     over-count. So a mistake seen HABIT_THRESHOLD times is always
+ *     reported as a habit.
+ *   - it exceeds the exact count by more than e*N/w with probability at
+ *     most e^-d. Updates are conservative (only the smallest counters
+ *     grow), which in practice keeps most estimates exact.
+ *   - a never-seen mistake passes the Bloom filter with probability about
+ *     (1 - e^(-k*n/m))^k for n distinct mistakes, m filter bits and
+ *     k = HABIT_SKETCH_HASHES; only then are counters read from disk.
+ * hasc --sketch-audit measures the actual error against the exact log,
+ * which covers a sketch freshly seeded from it.
+ *
+ * Updates take an advisory file lock, so processes can share one sketch.
+ */
+
+/* Use the sketch for this run; `bytes` sizes a newly created sketch (0 for
+ * the default). Falls back to the exact log if the file is unusable. */
+void habit_sketch_enable(size_t bytes);
+int habit_sketch_enabled(void);
+/* Follow a profile_select(): reopen on the new profile if --sketch is on */
+void habit_sketch_retarget(void);
+void habit_sketch_close(void);
+
+void habit_sketch_add(ErrorCode code, const Token *token);
+/* Upper bound on how often this mistake was logged */
+unsigned long habit_sketch_estimate(ErrorCode code, const Token *token);
+
+/* Compare the sketch against exact counts from the history log. Returns 1
+ * when there is no sketch or no history, 0 otherwise. */
+int habit_sketch_audit(FILE *out);
+
+#endif /* HABIT_SKETCH_H */
@@ -0,0 +1,27 @@
+#ifndef HABITS_H
+#define HABITS_H
+
+#include <stdio.h>
+
+typedef enum {
+    HABITS_TEXT,
+    HABITS_JSON
+} HabitsFormat;
+
+/*
+ * Print the top_n most frequent mistakes in the current profile's habit
+ * history, a histogram per error kind, the top_n mistakes of each kind and
+ * a per-file breakdown. A mistake is a logged fingerprint in one file;
+ * JSON gives its code, token type, lexeme, line, column and file as
+ * separate fields.
+ *
+ * Counts come from an aggregated index (PROFILE_INDEX) that records
+ * how far into the history log it has already been folded. Only log lines
+ * appended since then are read, and the index is rewritten afterwards, so
+ * the cost is proportional to the number of distinct fingerprints plus new
+ * events rather than the whole history. Returns 0 on success, 1 when there
+ * is no history.
+ */
+int habits_report(FILE *out, int top_n, HabitsFormat format);
+
+#endif /* HABITS_H */
@@ -2,10 +2,8 @@
 #define HIGHLIGHTER_H
 
 #include "lexer.h"
+#include "error_handler.h"
 
-void highlight_error(const char *error_type,
-                     const char *expected_type,
-                     const char *expected_lexeme,
-                     const Token *actual_token);
+void highlight_error(ErrorCode code, const Token *actual_token);
 
 #endif /* HIGHLIGHTER_H */
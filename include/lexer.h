@@ -1,6 +1,9 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include <stdio.h>
+#include "symbol_table.h"
+
 typedef enum {
     TOKEN_KEYWORD,
     TOKEN_IDENTIFIER,
@@ -17,8 +20,41 @@ typedef struct {
     int column;
 } Token;
 
+/* One token of a TokenArray. The lexeme is an intern id in the array's
+ * string table, so a stored token takes 16 bytes, not sizeof(Token). */
+typedef struct {
+    unsigned char type;   /* TokenType */
+    int lexeme;
+    int line;
+    int column;
+} PackedToken;
+
+/* A fully lexed input, terminated by a TOKEN_EOF entry */
+typedef struct {
+    PackedToken *tokens;
+    int count;
+    int capacity;
+    SymbolTable lexemes;  /* each distinct spelling once */
+} TokenArray;
+
+const char* token_type_to_string(TokenType type);
+
+/* Lex from a file path, or from stdin when the path is "-" */
 void init_lexer(const char *filename);
+/* Lex from an already-open stream (stdin, a pipe, ...); not closed by close_lexer */
+void init_lexer_stream(FILE *stream);
+/* Lex `size` bytes at `data`; the buffer must outlive close_lexer() */
+void init_lexer_buffer(const char *data, size_t size);
 Token get_next_token(void);
 void close_lexer(void);
 
+void token_array_init(TokenArray *array);
+void token_array_free(TokenArray *array);
+void token_array_push(TokenArray *array, const Token *token);
+/* Unpack token `index` */
+Token token_array_at(const TokenArray *array, int index);
+const char *token_array_lexeme(const TokenArray *array, int index);
+/* Lex the rest of the current input into `array`, including the EOF token */
+void lex_all(TokenArray *array);
+
 #endif /* LEXER_H */
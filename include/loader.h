@@ -0,0 +1,48 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <stddef.h>
+
+/*
+ * Read-ahead stage for batch compilation (--batch). Files are handed out
+ * strictly in list order, while reads for the next `depth` files are
+ * already in flight, so lexing file N overlaps I/O for N+1..N+depth.
+ * Buffers handed out but not yet released, plus reads in flight, are
+ * kept under `budget` bytes; the file the caller waits for is always let
+ * through, so one oversized file cannot stall the batch.
+ *
+ * Backends: I/O threads by default; io_uring when built with
+ * -DHASC_IO_URING on Linux (falling back to threads if the kernel
+ * refuses). depth 0 reads each file synchronously in loader_next().
+ * io_uring sizes the window's files with statx and opens a file only once
+ * the budget admits it, keeping at most 1/LOADER_FD_SHARE of
+ * RLIMIT_NOFILE descriptors open, so a deep window cannot run out of them.
+ */
+typedef enum {
+    LOADER_SYNC,
+    LOADER_THREADS,
+    LOADER_IO_URING
+} LoaderBackend;
+
+typedef struct {
+    int index;
+    const char *path;
+    char *data;           /* NULL if the file could not be read */
+    size_t size;
+} LoadedFile;
+
+typedef struct Loader Loader;
+
+Loader *loader_open(const char *const *paths, int count, int depth, size_t budget);
+/* Next file in order; returns 0 when the list is exhausted */
+int loader_next(Loader *loader, LoadedFile *file);
+/* Give a file's buffer (and its share of the budget) back */
+void loader_release(Loader *loader, LoadedFile *file);
+void loader_close(Loader *loader);
+
+LoaderBackend loader_backend(const Loader *loader);
+const char *loader_backend_name(LoaderBackend backend);
+/* Time loader_next() spent waiting for data */
+double loader_wait_ms(const Loader *loader);
+
+#endif /* LOADER_H */
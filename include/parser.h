@@ -1,8 +1,30 @@
 #ifndef PARSER_H
 #define PARSER_H
 
-void parser_init(void);
-void parse_program(void);
+#include "lexer.h"
+#include "ast.h"
+#include "autofix.h"
+
+void parser_init(AutofixContext *autofix, Ast *ast);
+/* Worker threads for parse_program_tokens(); 0 picks the core count */
+void parser_set_threads(int threads);
+/* Both return 1 when the whole program parsed (possibly after auto-fixes).
+ * parse_program() pulls tokens from the lexer one at a time;
+ * parse_program_tokens() splits a lexed input into functions and parses
+ * their bodies in parallel. */
+int parse_program(void);
+
+/*
+ * Hand what parse_program() reads to `sink` as it goes: each time the
+ * function being read has at least PARSE_STREAM_CHUNK complete top-level
+ * statements (`done` 0), and when it closes (`done` 1). The sink may drop
+ * them with ast_drop_body() or ast_clear(), so streamed input never has
+ * to be held whole. NULL, the default, keeps the whole Ast.
+ */
+typedef void (*ParseSinkFn)(Ast *ast, int function, int done, void *arg);
+void parser_set_sink(ParseSinkFn sink, void *arg);
+
+int parse_program_tokens(const TokenArray *array);
 void parser_close(void);
 
 #endif /* PARSER_H */
@@ -0,0 +1,75 @@
+#ifndef PROFILE_STORE_H
+#define PROFILE_STORE_H
+
+#include <stdio.h>
+#include "lexer.h"
+#include "error_handler.h"
+
+#define PROFILE_DATA_DIR "data"
+#define PROFILE_ID_MAX 64
+
+typedef enum {
+    PROFILE_LOG,          /* history log: one record per logged error */
+    PROFILE_INDEX,        /* aggregated --habits index */
+    PROFILE_SKETCH        /* --sketch counts */
+} ProfileFile;
+
+/*
+ * Habit profiles, one per user. The default profile (no user id) keeps
+ * its files directly in data/; a user's profile lives in
+ *   data/users/<h0>/<h1>/<id>/
+ * where h0 and h1 are two bytes of a hash of the id in hex, so 65536
+ * shard directories keep every directory small and finding a profile is
+ * one path computation however many users there are. Characters outside
+ * [A-Za-z0-9_-.] are %XX-escaped in <id>.
+ *
+ * Recently active profiles stay in an LRU cache of PROFILE_CACHE_SIZE
+ * entries. Selecting one reads nothing. Its exact counts per mistake are
+ * loaded by the first profile_count(), which --sketch never calls, from
+ * the aggregated index (PROFILE_INDEX) plus the log written after it, so
+ * a miss costs one line per distinct mistake and the unindexed tail
+ * rather than the whole history. Once PROFILE_INDEX_TAIL_BYTES of log
+ * have piled up past the index, it is rewritten when the profile is
+ * loaded, evicted or at exit.
+ *
+ * New records are written back to the log when the profile is evicted,
+ * when more than PROFILE_WRITEBACK_BYTES are pending, on
+ * profile_store_flush() and at exit. Records other processes append to
+ * the same log are folded into loaded counts whenever the profile is
+ * selected or flushed. A flush holds an exclusive lock on the log from
+ * the fold through its own append, so the counts end exactly where the
+ * log does; a record left unterminated by a crashed writer is closed off
+ * with a newline first, so it cannot swallow the next one.
+ *
+ * Not thread-safe: one profile is current per process at a time.
+ */
+
+/* Make `user_id` (NULL or "" for the default profile) current. Returns 0,
+ * or 1 when the id is too long; the current profile is then unchanged. */
+int profile_select(const char *user_id);
+/* Current user id, "" for the default profile */
+const char *profile_current_user(void);
+
+/* Path of one of the current profile's files */
+const char *profile_path(ProfileFile which);
+/* Create the current profile's directory if data/ exists; returns 0 when
+ * it is there */
+int profile_prepare_dir(void);
+
+/* Record a logged error (its formatted log line) against the current profile */
+void profile_append(const char *record_line);
+/* Exact number of times this mistake was logged in the current profile */
+unsigned long profile_count(ErrorCode code, const Token *token);
+
+/* Advisory whole-file lock, shared by log writers and the sketch;
+ * unlocking flushes the stream first */
+void profile_lock_file(FILE *file, int exclusive);
+void profile_unlock_file(FILE *file);
+
+/* Write pending records of every cached profile to disk */
+void profile_store_flush(void);
+/* Remove the current profile's files */
+int profile_reset(void);
+void profile_store_close(void);
+
+#endif /* PROFILE_STORE_H */
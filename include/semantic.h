@@ -0,0 +1,33 @@
+#ifndef SEMANTIC_H
+#define SEMANTIC_H
+
+#include "ast.h"
+#include "symbol_table.h"
+
+/* Resolve every variable reference in a parsed program, reporting
+ * undeclared and redeclared variables as errors and unused ones as
+ * warnings. Resolved slots are written back into the Ast. Returns the
+ * number of errors. */
+int semantic_check(Ast *ast, SymbolTable *symbols);
+
+/*
+ * The same check a piece at a time, for input that is never held whole:
+ *   semantic_begin()
+ *   per function: semantic_begin_function(), semantic_check_statements()
+ *     over each run of its body whose blocks are all closed, in order,
+ *     then semantic_end_function()
+ *   semantic_end(), which returns the number of errors and reports
+ *     unused variables not released yet unless told not to
+ * Once semantic_check_statements() returns, those statements (and the
+ * rest of the Ast but the function's name) may be dropped. With `release`
+ * a function's unused variables are reported when it ends and its
+ * symbols are freed for the next one, so memory does not grow with the
+ * number of functions beyond one interned name each.
+ */
+void semantic_begin(SymbolTable *symbols);
+void semantic_begin_function(Ast *ast, int function);
+void semantic_check_statements(Ast *ast, int from, int to);
+void semantic_end_function(int release);
+int semantic_end(int report_unused);
+
+#endif /* SEMANTIC_H */
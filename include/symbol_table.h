@@ -0,0 +1,72 @@
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/* One declared variable. Its index in SymbolTable.symbols is the dense
+ * slot later stages use to address storage for it. */
+typedef struct {
+    int name;             /* intern id */
+    int line;
+    int column;
+    int depth;            /* scope depth of the declaration */
+    int used;
+} Symbol;
+
+typedef struct {
+    int name;             /* intern id rebound by a declaration */
+    int previous;         /* binding to restore when the scope is popped */
+} ScopeUndo;
+
+/*
+ * Identifiers are interned through an open-addressing (linear probing)
+ * hash table, so every distinct spelling maps to a small integer id.
+ * Each id carries its innermost binding directly; nested scopes are an
+ * undo log of shadowed bindings. Lookup therefore costs one hash probe
+ * sequence regardless of scope depth or the number of identifiers.
+ */
+typedef struct {
+    int *buckets;             /* intern id per bucket, -1 when empty */
+    int bucket_capacity;      /* power of two */
+
+    char *pool;               /* NUL-terminated spellings */
+    size_t pool_len;
+    size_t pool_capacity;
+    int *offsets;             /* per intern id: offset into pool */
+    unsigned int *hashes;     /* per intern id: cached hash for rehashing */
+    int *bindings;            /* per intern id: innermost symbol, or -1 */
+    int intern_count;
+    int intern_capacity;
+
+    Symbol *symbols;
+    int symbol_count;
+    int symbol_capacity;
+
+    ScopeUndo *undo;
+    int undo_count;
+    int undo_capacity;
+    int *scope_marks;         /* undo_count at each scope push */
+    int depth;
+    int scope_capacity;
+
+    /* Statistics for the timing report */
+    unsigned long long lookups;
+    unsigned long long probes;
+    int max_probe;
+} SymbolTable;
+
+void symbol_table_init(SymbolTable *table);
+void symbol_table_free(SymbolTable *table);
+
+int symbol_intern(SymbolTable *table, const char *name);
+const char *symbol_spelling(const SymbolTable *table, int name);
+
+void symbol_push_scope(SymbolTable *table);
+void symbol_pop_scope(SymbolTable *table);
+int symbol_declare(SymbolTable *table, int name, int line, int column);
+int symbol_lookup(const SymbolTable *table, int name);
+
+void symbol_table_print_stats(const SymbolTable *table, FILE *out);
+
+#endif /* SYMBOL_TABLE_H */
@@ -2,10 +2,8 @@
 #define THRESHOLD_H
 
 #include "lexer.h"
+#include "error_handler.h"
 
-int threshold_check(const char *error_type,
-                   const char *expected_type,
-                   const char *expected_lexeme,
-                   const Token *actual_token);
+int threshold_check(ErrorCode code, const Token *actual_token);
 
 #endif /* THRESHOLD_H */
@@ -0,0 +1,30 @@
+#ifndef TOKEN_FILE_H
+#define TOKEN_FILE_H
+
+#include "lexer.h"
+
+/*
+ * Binary token-stream dump (--emit-tokens / --load-tokens).
+ *
+ * Layout, all integers little-endian:
+ *   header   "HASCTOK\0", u32 version, u32 token_count, u32 string_count,
+ *            u32 stream_bytes, u32 pool_bytes
+ *   kinds    token_count bytes, one TokenType each
+ *   stream   per token three LEB128 varints: lexeme id into the pool,
+ *            zigzag line delta, zigzag column delta (from column 0 when
+ *            the line changed)
+ *   pool     string_count interned lexemes, each a varint length + bytes
+ *
+ * The stream ends with the TOKEN_EOF token, like lex_all(). Files with a
+ * different version are rejected rather than guessed at.
+ */
+#define TOKEN_FILE_VERSION 1
+
+/* Returns 0 on success */
+int token_file_write(const char *path, const TokenArray *array);
+
+/* Map a dump and decode it into `array` without lexing; returns 0 on
+ * success, non-zero for an unreadable or malformed file. */
+int token_file_load(const char *path, TokenArray *array);
+
+#endif /* TOKEN_FILE_H */
@@ -0,0 +1,227 @@
+// Flat syntax tree storage
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ast.h"
+
+static void *grow_array(void *data, int *capacity, size_t elem_size) {
+    int new_capacity = *capacity ? *capacity * 2 : 64;
+    void *grown = realloc(data, (size_t)new_capacity * elem_size);
+    if (grown == NULL) {
+        fprintf(stderr, "Error: Out of memory while building syntax tree\n");
+        exit(1);
+    }
+    *capacity = new_capacity;
+    return grown;
+}
+
+void ast_init(Ast *ast) {
+    memset(ast, 0, sizeof(*ast));
+}
+
+void ast_free(Ast *ast) {
+    free(ast->functions);
+    free(ast->stmts);
+    free(ast->exprs);
+    free(ast->names);
+    memset(ast, 0, sizeof(*ast));
+}
+
+void ast_clear(Ast *ast) {
+    ast->function_count = 0;
+    ast->stmt_count = 0;
+    ast->expr_count = 0;
+    ast->names_len = 0;
+}
+
+void ast_drop_body(Ast *ast) {
+    FunctionNode function;
+    size_t len;
+
+    if (ast->function_count == 0) {
+        ast_clear(ast);
+        return;
+    }
+    function = ast->functions[ast->function_count - 1];
+    len = strlen(ast->names + function.name) + 1;
+    memmove(ast->names, ast->names + function.name, len);
+
+    function.name = 0;
+    function.body_start = 0;
+    function.body_end = 0;
+    ast->functions[0] = function;
+    ast->function_count = 1;
+    ast->stmt_count = 0;
+    ast->expr_count = 0;
+    ast->names_len = len;
+}
+
+int ast_add_function(Ast *ast, const char *name, int line, int column) {
+    FunctionNode *function;
+
+    if (ast->function_count == ast->function_capacity) {
+        ast->functions = grow_array(ast->functions, &ast->function_capacity, sizeof(FunctionNode));
+    }
+
+    function = &ast->functions[ast->function_count];
+    function->name = ast_add_name(ast, name);
+    function->line = line;
+    function->column = column;
+    function->body_start = ast->stmt_count;
+    function->body_end = ast->stmt_count;
+    return ast->function_count++;
+}
+
+int ast_add_stmt(Ast *ast, StmtKind kind, int line, int column) {
+    StmtNode *stmt;
+
+    if (ast->stmt_count == ast->stmt_capacity) {
+        ast->stmts = grow_array(ast->stmts, &ast->stmt_capacity, sizeof(StmtNode));
+    }
+
+    stmt = &ast->stmts[ast->stmt_count];
+    stmt->kind = (unsigned char)kind;
+    stmt->line = line;
+    stmt->column = column;
+    stmt->name = -1;
+    stmt->slot = -1;
+    stmt->expr = -1;
+    stmt->end = ast->stmt_count + 1;
+    stmt->else_branch = -1;
+    return ast->stmt_count++;
+}
+
+int ast_add_expr(Ast *ast, const ExprNode *node) {
+    if (ast->expr_count == ast->expr_capacity) {
+        ast->exprs = grow_array(ast->exprs, &ast->expr_capacity, sizeof(ExprNode));
+    }
+    ast->exprs[ast->expr_count] = *node;
+    return ast->expr_count++;
+}
+
+int ast_add_name(Ast *ast, const char *name) {
+    size_t len = strlen(name) + 1;
+    size_t offset = ast->names_len;
+
+    if (ast->names_len + len > ast->names_capacity) {
+        size_t new_capacity = ast->names_capacity ? ast->names_capacity : 256;
+        char *grown;
+
+        while (ast->names_len + len > new_capacity) {
+            new_capacity *= 2;
+        }
+        grown = realloc(ast->names, new_capacity);
+        if (grown == NULL) {
+            fprintf(stderr, "Error: Out of memory while building syntax tree\n");
+            exit(1);
+        }
+        ast->names = grown;
+        ast->names_capacity = new_capacity;
+    }
+
+    memcpy(ast->names + offset, name, len);
+    ast->names_len += len;
+    return (int)offset;
+}
+
+const char *ast_name(const Ast *ast, int name) {
+    return ast->names + name;
+}
+
+static void reserve(void **data, int *capacity, int needed, size_t elem_size) {
+    while (*capacity < needed) {
+        *data = grow_array(*data, capacity, elem_size);
+    }
+}
+
+void ast_append(Ast *dst, const Ast *src) {
+    int stmt_base = dst->stmt_count;
+    int expr_base = dst->expr_count;
+    int name_base = (int)dst->names_len;
+    int i;
+
+    reserve((void **)&dst->functions, &dst->function_capacity,
+            dst->function_count + src->function_count, sizeof(FunctionNode));
+    reserve((void **)&dst->stmts, &dst->stmt_capacity,
+            dst->stmt_count + src->stmt_count, sizeof(StmtNode));
+    reserve((void **)&dst->exprs, &dst->expr_capacity,
+            dst->expr_count + src->expr_count, sizeof(ExprNode));
+
+    if (dst->names_len + src->names_len > dst->names_capacity) {
+        size_t new_capacity = dst->names_capacity ? dst->names_capacity : 256;
+        char *grown;
+        while (dst->names_len + src->names_len > new_capacity) {
+            new_capacity *= 2;
+        }
+        grown = realloc(dst->names, new_capacity);
+        if (grown == NULL) {
+            fprintf(stderr, "Error: Out of memory while building syntax tree\n");
+            exit(1);
+        }
+        dst->names = grown;
+        dst->names_capacity = new_capacity;
+    }
+    if (src->names_len > 0) {
+        memcpy(dst->names + dst->names_len, src->names, src->names_len);
+    }
+    dst->names_len += src->names_len;
+
+    for (i = 0; i < src->function_count; i++) {
+        FunctionNode function = src->functions[i];
+        function.name += name_base;
+        function.body_start += stmt_base;
+        function.body_end += stmt_base;
+        dst->functions[dst->function_count++] = function;
+    }
+
+    for (i = 0; i < src->stmt_count; i++) {
+        StmtNode stmt = src->stmts[i];
+        if (stmt.name >= 0) {
+            stmt.name += name_base;
+        }
+        if (stmt.expr >= 0) {
+            stmt.expr += expr_base;
+        }
+        if (stmt.else_branch >= 0) {
+            stmt.else_branch += stmt_base;
+        }
+        stmt.end += stmt_base;
+        dst->stmts[dst->stmt_count++] = stmt;
+    }
+
+    for (i = 0; i < src->expr_count; i++) {
+        ExprNode expr = src->exprs[i];
+        switch (expr.kind) {
+            case EXPR_IDENTIFIER:
+                expr.as.name += name_base;
+                break;
+            case EXPR_NEGATE:
+                expr.as.operand += expr_base;
+                break;
+            case EXPR_BINARY:
+                expr.as.bin.lhs += expr_base;
+                expr.as.bin.rhs += expr_base;
+                break;
+            default:
+                break;
+        }
+        dst->exprs[dst->expr_count++] = expr;
+    }
+}
+
+const char *binary_op_to_string(BinaryOp op) {
+    switch (op) {
+        case OP_ADD: return "+";
+        case OP_SUB: return "-";
+        case OP_MUL: return "*";
+        case OP_DIV: return "/";
+        case OP_LT:  return "<";
+        case OP_GT:  return ">";
+        case OP_LE:  return "<=";
+        case OP_GE:  return ">=";
+        case OP_EQ:  return "==";
+        case OP_NE:  return "!=";
+        default:     return "?";
+    }
+}
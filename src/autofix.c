@@ -1,96 +1,156 @@
 // Temporary auto-correction
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "config.h"
 #include "lexer.h"
 #include "autofix.h"
 
-static int autofix_count = 0;
-static int autofixed_lines[MAX_AUTOFIX_LINES];
-static int autofixed_line_count = 0;
+void autofix_context_init(AutofixContext *ctx) {
+    ctx->applied_count = 0;
+    ctx->max_per_run = MAX_AUTOFIX_PER_RUN;
+    ctx->line_bits = NULL;
+    ctx->line_bits_size = 0;
+}
 
-void autofix_reset_count(void) {
-    autofix_count = 0;
+void autofix_context_free(AutofixContext *ctx) {
+    free(ctx->line_bits);
+    ctx->line_bits = NULL;
+    ctx->line_bits_size = 0;
 }
 
-int autofix_limit_reached(void) {
-    return autofix_count >= MAX_AUTOFIX_PER_RUN;
+void autofix_set_max_per_run(AutofixContext *ctx, int max_per_run) {
+    ctx->max_per_run = max_per_run < 0 ? 0 : max_per_run;
 }
 
-void autofix_record_applied(void) {
-    autofix_count++;
+void autofix_reset_count(AutofixContext *ctx) {
+    ctx->applied_count = 0;
 }
 
-void autofix_reset_lines(void) {
-    autofixed_line_count = 0;
+int autofix_limit_reached(const AutofixContext *ctx) {
+    return ctx->applied_count >= ctx->max_per_run;
 }
 
-int autofix_already_applied_on_line(int line) {
-    int i;
+void autofix_record_applied(AutofixContext *ctx) {
+    ctx->applied_count++;
+}
 
-    for (i = 0; i < autofixed_line_count; i++) {
-        if (autofixed_lines[i] == line) {
-            return 1;
-        }
+void autofix_reset_lines(AutofixContext *ctx) {
+    if (ctx->line_bits != NULL) {
+        memset(ctx->line_bits, 0, ctx->line_bits_size);
+    }
+}
+
+int autofix_already_applied_on_line(const AutofixContext *ctx, int line) {
+    size_t byte;
+
+    if (line < 0) {
+        return 0;
     }
 
-    return 0;
+    byte = (size_t)line >> 3;
+    if (byte >= ctx->line_bits_size) {
+        return 0;
+    }
+
+    return (ctx->line_bits[byte] >> (line & 7)) & 1;
 }
 
-void autofix_record_line(int line) {
-    if (autofixed_line_count >= MAX_AUTOFIX_LINES) {
+void autofix_record_line(AutofixContext *ctx, int line) {
+    size_t byte;
+
+    if (line < 0) {
         return;
     }
 
-    autofixed_lines[autofixed_line_count] = line;
-    autofixed_line_count++;
-}
+    byte = (size_t)line >> 3;
+    if (byte >= ctx->line_bits_size) {
+        /* Grow geometrically so recording N lines costs O(N) overall */
+        size_t new_size = ctx->line_bits_size ? ctx->line_bits_size : 64;
+        unsigned char *grown;
 
-int is_safe_autofix_error(const char *expected_token, const char *actual_token) {
-    if (expected_token == NULL || actual_token == NULL) {
-        return 0;
+        while (new_size <= byte) {
+            new_size *= 2;
+        }
+
+        grown = realloc(ctx->line_bits, new_size);
+        if (grown == NULL) {
+            return;
+        }
+
+        memset(grown + ctx->line_bits_size, 0, new_size - ctx->line_bits_size);
+        ctx->line_bits = grown;
+        ctx->line_bits_size = new_size;
     }
 
-    if (strcmp(expected_token, ";") != 0) {
+    ctx->line_bits[byte] |= (unsigned char)(1u << (line & 7));
+}
+
+int is_safe_autofix_error(ErrorCode code, const Token *actual_token) {
+    if (code != E_MISSING_SEMICOLON || actual_token == NULL) {
         return 0;
     }
 
-    if (strcmp(actual_token, "TOKEN_IDENTIFIER") == 0) {
+    if (actual_token->type == TOKEN_IDENTIFIER) {
         return 1;
     }
 
-    if (strcmp(actual_token, "}") == 0) {
+    if (actual_token->type == TOKEN_SYMBOL && strcmp(actual_token->lexeme, "}") == 0) {
         return 1;
     }
 
     return 0;
 }
 
-AutofixResult autofix_try(const char *error_type,
-                         const char *expected_type,
-                         const char *expected_lexeme,
-                         const Token *actual_token) {
-    /* Only auto-fix missing semicolon errors */
-    if (strcmp(error_type, "syntax_error") != 0) {
+AutofixResult autofix_try(ErrorCode code,
+                         const Token *actual_token,
+                         const RepairTrial *trial,
+                         RepairCandidate *repair) {
+    RepairCandidate candidates[2];
+    int candidate_count = 0;
+    int best = -1;
+    int best_score = REPAIR_MIN_PROGRESS - 1;
+    char symbol = error_repair_symbol(code);
+    int i;
+
+    /* Only errors at a missing symbol can be repaired */
+    if (symbol == 0) {
         return AUTOFIX_NOT_APPLIED;
     }
-    
-    /* Check if expected token is semicolon */
-    if (expected_type == NULL || strcmp(expected_type, "TOKEN_SYMBOL") != 0) {
-        return AUTOFIX_NOT_APPLIED;
+
+    candidates[candidate_count].kind = REPAIR_INSERT;
+    candidates[candidate_count].lexeme[0] = symbol;
+    candidates[candidate_count].lexeme[1] = '\0';
+    candidate_count++;
+
+    if (trial == NULL) {
+        /* No lookahead: insert the expected symbol unscored */
+        *repair = candidates[0];
+        return AUTOFIX_APPLIED;
     }
-    
-    if (expected_lexeme == NULL) {
-        return AUTOFIX_NOT_APPLIED;
+
+    if (actual_token->type != TOKEN_EOF) {
+        candidates[candidate_count].kind = REPAIR_DELETE;
+        candidates[candidate_count].lexeme[0] = '\0';
+        candidate_count++;
     }
-    
-    /* Auto-fix case 1 & 2: Missing semicolon at end of statement and before brace */
-    if (strcmp(expected_lexeme, ";") == 0) {
-        return AUTOFIX_APPLIED;
+
+    /* Each error point is scored exactly once before the parse moves past
+     * it, so trial results are not worth keeping */
+    for (i = 0; i < candidate_count; i++) {
+        int score = trial->run(trial->arg, &candidates[i]);
+
+        if (score > best_score) {
+            best = i;
+            best_score = score;
+        }
     }
-    
-    /* Auto-fix case 3: Missing semicolon at end of statement (when we get EOF) */
-    /* Note: We don't auto-fix EOF cases as they're not safe to continue */
-    
-    return AUTOFIX_NOT_APPLIED;
+
+    if (best < 0) {
+        return AUTOFIX_NOT_APPLIED;
+    }
+
+    *repair = candidates[best];
+    return AUTOFIX_APPLIED;
 }
@@ -1 +1,86 @@
 // Error codes & reporting
+
+#include <string.h>
+#include "error_handler.h"
+
+typedef struct {
+    const char *name;
+    const char *kind;
+    const char *expected_type;
+    const char *expected_lexeme;
+    char repair;
+    const char *message;
+} ErrorInfo;
+
+static const ErrorInfo error_table[ERROR_CODE_COUNT] = {
+#define X(code, kind, expected_type, expected_lexeme, repair, message) \
+    { #code, kind, expected_type, expected_lexeme, repair, message },
+    ERROR_CODE_LIST(X)
+#undef X
+};
+
+static const ErrorInfo *error_info(ErrorCode code) {
+    static const ErrorInfo unknown = { "E_UNKNOWN", "", "", "", 0, "Unknown error" };
+    return (unsigned)code < ERROR_CODE_COUNT ? &error_table[code] : &unknown;
+}
+
+const char *error_code_name(ErrorCode code) {
+    return error_info(code)->name;
+}
+
+const char *error_kind(ErrorCode code) {
+    return error_info(code)->kind;
+}
+
+const char *error_expected_type(ErrorCode code) {
+    return error_info(code)->expected_type;
+}
+
+const char *error_expected_lexeme(ErrorCode code) {
+    return error_info(code)->expected_lexeme;
+}
+
+const char *error_message(ErrorCode code) {
+    return error_info(code)->message;
+}
+
+char error_repair_symbol(ErrorCode code) {
+    return error_info(code)->repair;
+}
+
+int error_code_from_name(const char *name) {
+    int code;
+    for (code = 0; code < ERROR_CODE_COUNT; code++) {
+        if (strcmp(error_table[code].name, name) == 0) {
+            return code;
+        }
+    }
+    return -1;
+}
+
+int error_code_from_fields(const char *kind, const char *expected_type, const char *expected_lexeme) {
+    int code;
+    for (code = 0; code < ERROR_CODE_COUNT; code++) {
+        if (strcmp(error_table[code].kind, kind) == 0 &&
+            strcmp(error_table[code].expected_type, expected_type) == 0 &&
+            strcmp(error_table[code].expected_lexeme, expected_lexeme) == 0) {
+            return code;
+        }
+    }
+
+    if (strcmp(kind, "syntax_error") == 0) {
+        if (strcmp(expected_type, "TOKEN_KEYWORD") == 0) {
+            return E_EXPECTED_KEYWORD;
+        }
+        if (strcmp(expected_type, "TOKEN_IDENTIFIER") == 0) {
+            return E_EXPECTED_IDENTIFIER;
+        }
+        if (strcmp(expected_type, "TOKEN_NUMBER") == 0) {
+            return E_EXPECTED_NUMBER;
+        }
+        if (strcmp(expected_type, "TOKEN_SYMBOL") == 0) {
+            return E_EXPECTED_SYMBOL;
+        }
+    }
+    return -1;
+}
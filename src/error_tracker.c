@@ -1,40 +1,127 @@
 // Error history (user profile)
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include "lexer.h"
 #include "error_tracker.h"
+#include "habit_sketch.h"
+#include "profile_store.h"
 
-static const char* token_type_to_string(TokenType type) {
-    switch (type) {
-        case TOKEN_KEYWORD:    return "TOKEN_KEYWORD";
-        case TOKEN_IDENTIFIER: return "TOKEN_IDENTIFIER";
-        case TOKEN_NUMBER:     return "TOKEN_NUMBER";
-        case TOKEN_SYMBOL:     return "TOKEN_SYMBOL";
-        case TOKEN_EOF:        return "TOKEN_EOF";
-        case TOKEN_UNKNOWN:    return "TOKEN_UNKNOWN";
-        default:               return "UNKNOWN";
+static char source_name[260] = "";
+
+void error_tracker_set_source(const char *name) {
+    size_t i;
+
+    strncpy(source_name, name ? name : "", sizeof(source_name) - 1);
+    source_name[sizeof(source_name) - 1] = '\0';
+
+    /* The name is the last field of a '|'-separated record */
+    for (i = 0; source_name[i] != '\0'; i++) {
+        if (source_name[i] == '|' || source_name[i] == '\n' || source_name[i] == '\r') {
+            source_name[i] = '_';
+        }
+    }
+}
+
+void error_tracker_log(ErrorCode code, const Token *actual_token) {
+    char record[512];
+
+    snprintf(record, sizeof(record), "%d|%d|%d|%d|%s|%s",
+             (int)code,
+             (int)actual_token->type,
+             actual_token->line,
+             actual_token->column,
+             actual_token->lexeme,
+             source_name);
+
+    /* Under --sketch the sketch is the whole record, so the log does not
+     * keep growing; otherwise it is written back to the current profile's
+     * log, the exact record (--habits, --sketch-audit) */
+    if (habit_sketch_enabled()) {
+        habit_sketch_add(code, actual_token);
+    } else {
+        profile_append(record);
+    }
+}
+
+/* Read "<int>|" at *cursor and step past it */
+static int parse_int_field(char **cursor, int *value) {
+    char *end;
+    long parsed = strtol(*cursor, &end, 10);
+
+    if (end == *cursor || *end != '|') {
+        return 0;
+    }
+    *value = (int)parsed;
+    *cursor = end + 1;
+    return 1;
+}
+
+/* error_type|expected_type|expected_lexeme|actual_type|actual_lexeme|line|column[|file] */
+static int parse_legacy_record(char *line, ErrorRecord *record) {
+    char *fields[8];
+    int count = 0;
+    int code;
+    int type;
+
+    fields[count++] = line;
+    for (; *line != '\0' && count < 8; line++) {
+        if (*line == '|') {
+            *line = '\0';
+            fields[count++] = line + 1;
+        }
     }
+    if (count < 7) {
+        return 0;
+    }
+
+    code = error_code_from_fields(fields[0], fields[1], fields[2]);
+    if (code < 0) {
+        return 0;
+    }
+    for (type = TOKEN_KEYWORD; type <= TOKEN_UNKNOWN; type++) {
+        if (strcmp(token_type_to_string((TokenType)type), fields[3]) == 0) {
+            break;
+        }
+    }
+
+    record->code = (ErrorCode)code;
+    record->actual_type = (TokenType)type;
+    record->actual_lexeme = fields[4];
+    record->line = atoi(fields[5]);
+    record->column = atoi(fields[6]);
+    record->file = count == 8 ? fields[7] : "";
+    return 1;
 }
 
-void error_tracker_log(const char *error_type,
-                       const char *expected_type,
-                       const char *expected_lexeme,
-                       const Token *actual_token) {
-    FILE *profile = fopen("data/user_profile.dat", "a");
-    if (profile == NULL) {
-        /* Silently fail if file cannot be opened */
-        return;
-    }
-
-    fprintf(profile, "%s|%s|%s|%s|%s|%d|%d\n",
-            error_type,
-            expected_type ? expected_type : "",
-            expected_lexeme ? expected_lexeme : "",
-            token_type_to_string(actual_token->type),
-            actual_token->lexeme,
-            actual_token->line,
-            actual_token->column);
-
-    fclose(profile);
+int error_record_parse(char *line, ErrorRecord *record) {
+    char *cursor = line;
+    char *last_bar;
+    int code;
+    int type;
+
+    if (!isdigit((unsigned char)line[0])) {
+        return parse_legacy_record(line, record);
+    }
+
+    if (!parse_int_field(&cursor, &code) || !parse_int_field(&cursor, &type) ||
+        !parse_int_field(&cursor, &record->line) || !parse_int_field(&cursor, &record->column) ||
+        code < 0 || code >= ERROR_CODE_COUNT) {
+        return 0;
+    }
+
+    /* The file name never contains '|', the lexeme might */
+    last_bar = strrchr(cursor, '|');
+    if (last_bar == NULL) {
+        return 0;
+    }
+    *last_bar = '\0';
+
+    record->code = (ErrorCode)code;
+    record->actual_type = (TokenType)type;
+    record->actual_lexeme = cursor;
+    record->file = last_bar + 1;
+    return 1;
 }
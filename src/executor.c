@@ -1 +1,741 @@
 // Program execution
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "config.h"
+#include "ast.h"
+#include "executor.h"
+
+/* ---- Bytecode ---- */
+
+typedef enum {
+    BC_CONST,             /* push k */
+    BC_LOAD,              /* push slots[a] */
+    BC_NEG,
+    BC_BINARY,            /* pop rhs, lhs; push lhs sub rhs */
+    BC_STORE,             /* slots[a] = pop */
+    BC_PRINT,             /* print pop */
+    BC_BRANCH_FALSE,      /* if pop == 0 goto target */
+    BC_LOOP_TRUE,         /* back-edge; if pop != 0 goto target */
+    BC_JUMP,
+    BC_EXIT,
+
+    /* Superinstructions */
+    BC_STORE_CONST,       /* slots[a] = k */
+    BC_MOVE,              /* slots[a] = slots[b] */
+    BC_ADD_CONST,         /* slots[a] = slots[b] + k */
+    BC_BINARY_SS,         /* slots[a] = slots[b] sub slots[c] */
+    BC_BINARY_SK,         /* slots[a] = slots[b] sub k */
+    BC_BRANCH_NOT_SS,     /* if !(slots[a] sub slots[b]) goto target */
+    BC_BRANCH_NOT_SK,     /* if !(slots[a] sub k) goto target */
+    BC_LOOP_SS,           /* back-edge; if slots[a] sub slots[b] goto target */
+    BC_LOOP_SK            /* back-edge; if slots[a] sub k goto target */
+} Opcode;
+
+typedef struct {
+    unsigned char op;         /* Opcode */
+    unsigned char sub;        /* BinaryOp of fused and BC_BINARY instructions */
+    unsigned char ends_stmt;  /* completes one statement (for ExecStats.ops) */
+    int a;
+    int b;
+    int c;
+    int target;               /* jump target, or the expression node to blame */
+    long long k;
+} Instr;
+
+/* One compiled while loop: runs from its condition test until it exits */
+typedef struct {
+    Instr *code;
+    int count;
+    int capacity;
+    int max_stack;
+} LoopCode;
+
+typedef struct {
+    const Ast *ast;
+    const ExecOptions *options;
+    ExecStats *stats;
+    long long *slots;
+
+    int *loop_counts;         /* per statement: back-edges taken */
+    LoopCode **compiled;      /* per statement: bytecode for a hot loop */
+    int *loops;               /* interpreter: while loops being run */
+
+    long long *values;        /* expression stack for both tiers */
+    int value_capacity;
+
+    long long steps;
+    int error_node;           /* expression that failed, for the message */
+} Executor;
+
+static double exec_now_ms(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+static void *exec_alloc(size_t size) {
+    void *memory = calloc(1, size > 0 ? size : 1);
+    if (memory == NULL) {
+        fprintf(stderr, "Error: Out of memory while running program\n");
+        exit(1);
+    }
+    return memory;
+}
+
+static void reserve_values(Executor *ex, int needed) {
+    if (needed > ex->value_capacity) {
+        long long *grown = realloc(ex->values, (size_t)needed * sizeof(long long));
+        if (grown == NULL) {
+            fprintf(stderr, "Error: Out of memory while running program\n");
+            exit(1);
+        }
+        ex->values = grown;
+        ex->value_capacity = needed;
+    }
+}
+
+/* ---- Arithmetic (64-bit, wrapping) ---- */
+
+static long long wrap(unsigned long long value) {
+    return (long long)value;
+}
+
+/* Returns 0 on division by zero */
+static int apply_binary(int op, long long lhs, long long rhs, long long *out) {
+    switch (op) {
+        case OP_ADD: *out = wrap((unsigned long long)lhs + (unsigned long long)rhs); break;
+        case OP_SUB: *out = wrap((unsigned long long)lhs - (unsigned long long)rhs); break;
+        case OP_MUL: *out = wrap((unsigned long long)lhs * (unsigned long long)rhs); break;
+        case OP_DIV:
+            if (rhs == 0) {
+                return 0;
+            }
+            /* LLONG_MIN / -1 traps on some machines; wrap like the rest */
+            *out = rhs == -1 ? wrap(0ull - (unsigned long long)lhs) : lhs / rhs;
+            break;
+        case OP_LT: *out = lhs < rhs; break;
+        case OP_GT: *out = lhs > rhs; break;
+        case OP_LE: *out = lhs <= rhs; break;
+        case OP_GE: *out = lhs >= rhs; break;
+        case OP_EQ: *out = lhs == rhs; break;
+        default:    *out = lhs != rhs; break;
+    }
+    return 1;
+}
+
+static int compare(int op, long long lhs, long long rhs) {
+    switch (op) {
+        case OP_LT: return lhs < rhs;
+        case OP_GT: return lhs > rhs;
+        case OP_LE: return lhs <= rhs;
+        case OP_GE: return lhs >= rhs;
+        case OP_EQ: return lhs == rhs;
+        default:    return lhs != rhs;
+    }
+}
+
+static int is_comparison(int op) {
+    return op >= OP_LT && op <= OP_NE;
+}
+
+/* ---- Tier 0: interpreter ---- */
+
+/* An expression is a contiguous post-order run ending at its root; the
+ * run starts at the leftmost leaf */
+static int expr_start(const Ast *ast, int root) {
+    int node = root;
+
+    for (;;) {
+        const ExprNode *expr = &ast->exprs[node];
+        if (expr->kind == EXPR_NEGATE) {
+            node = expr->as.operand;
+        } else if (expr->kind == EXPR_BINARY) {
+            node = expr->as.bin.lhs;
+        } else {
+            return node;
+        }
+    }
+}
+
+static int eval_expr(Executor *ex, int root, long long *out) {
+    const ExprNode *exprs = ex->ast->exprs;
+    int start = expr_start(ex->ast, root);
+    long long *sp;
+    int i;
+
+    reserve_values(ex, root - start + 1);
+    sp = ex->values;
+    for (i = start; i <= root; i++) {
+        const ExprNode *node = &exprs[i];
+
+        switch (node->kind) {
+            case EXPR_NUMBER:
+                *sp++ = node->as.number;
+                break;
+            case EXPR_IDENTIFIER:
+                *sp++ = ex->slots[node->slot];
+                break;
+            case EXPR_NEGATE:
+                sp[-1] = wrap(0ull - (unsigned long long)sp[-1]);
+                break;
+            default:
+                sp--;
+                if (!apply_binary(node->op, sp[-1], sp[0], &sp[-1])) {
+                    ex->error_node = i;
+                    return 0;
+                }
+                break;
+        }
+    }
+    *out = sp[-1];
+    return 1;
+}
+
+/* ---- Tier 1: compiler ---- */
+
+static int emit(LoopCode *code, int op) {
+    if (code->count == code->capacity) {
+        int new_capacity = code->capacity ? code->capacity * 2 : 64;
+        Instr *grown = realloc(code->code, (size_t)new_capacity * sizeof(Instr));
+        if (grown == NULL) {
+            fprintf(stderr, "Error: Out of memory while compiling loop\n");
+            exit(1);
+        }
+        code->code = grown;
+        code->capacity = new_capacity;
+    }
+    memset(&code->code[code->count], 0, sizeof(Instr));
+    code->code[code->count].op = (unsigned char)op;
+    return code->count++;
+}
+
+/* Generic stack code for one expression */
+static void compile_expr(LoopCode *code, const Ast *ast, int root) {
+    int start = expr_start(ast, root);
+    int depth = 0;
+    int i;
+
+    for (i = start; i <= root; i++) {
+        const ExprNode *node = &ast->exprs[i];
+        int at;
+
+        switch (node->kind) {
+            case EXPR_NUMBER:
+                at = emit(code, BC_CONST);
+                code->code[at].k = node->as.number;
+                depth++;
+                break;
+            case EXPR_IDENTIFIER:
+                at = emit(code, BC_LOAD);
+                code->code[at].a = node->slot;
+                depth++;
+                break;
+            case EXPR_NEGATE:
+                emit(code, BC_NEG);
+                break;
+            default:
+                at = emit(code, BC_BINARY);
+                code->code[at].sub = node->op;
+                code->code[at].target = i;
+                depth--;
+                break;
+        }
+        if (depth > code->max_stack) {
+            code->max_stack = depth;
+        }
+    }
+}
+
+static void compile_assign(LoopCode *code, const Ast *ast, int slot, int root) {
+    const ExprNode *node = &ast->exprs[root];
+    int at;
+
+    if (node->kind == EXPR_NUMBER) {
+        at = emit(code, BC_STORE_CONST);
+        code->code[at].k = node->as.number;
+    } else if (node->kind == EXPR_IDENTIFIER) {
+        at = emit(code, BC_MOVE);
+        code->code[at].b = node->slot;
+    } else if (node->kind == EXPR_BINARY &&
+               ast->exprs[node->as.bin.lhs].kind == EXPR_IDENTIFIER &&
+               ast->exprs[node->as.bin.rhs].kind != EXPR_NEGATE &&
+               ast->exprs[node->as.bin.rhs].kind != EXPR_BINARY) {
+        const ExprNode *lhs = &ast->exprs[node->as.bin.lhs];
+        const ExprNode *rhs = &ast->exprs[node->as.bin.rhs];
+
+        if (rhs->kind == EXPR_NUMBER && (node->op == OP_ADD || node->op == OP_SUB)) {
+            /* x = y + k, x = y - k */
+            at = emit(code, BC_ADD_CONST);
+            code->code[at].k = node->op == OP_ADD ? rhs->as.number
+                                                  : wrap(0ull - (unsigned long long)rhs->as.number);
+        } else if (rhs->kind == EXPR_NUMBER) {
+            at = emit(code, BC_BINARY_SK);
+            code->code[at].k = rhs->as.number;
+        } else {
+            at = emit(code, BC_BINARY_SS);
+            code->code[at].c = rhs->slot;
+        }
+        code->code[at].b = lhs->slot;
+        code->code[at].sub = node->op;
+        code->code[at].target = root;
+    } else {
+        compile_expr(code, ast, root);
+        at = emit(code, BC_STORE);
+    }
+    code->code[at].a = slot;
+    code->code[at].ends_stmt = 1;
+}
+
+/* Test a condition; `back_edge` selects the loop-closing form that jumps
+ * to `target` when true, otherwise jump when false (target patched later).
+ * Returns the branch instruction. */
+static int compile_cond(LoopCode *code, const Ast *ast, int root, int back_edge, int target) {
+    const ExprNode *node = &ast->exprs[root];
+    int at;
+
+    if (node->kind == EXPR_BINARY && is_comparison(node->op) &&
+        ast->exprs[node->as.bin.lhs].kind == EXPR_IDENTIFIER &&
+        (ast->exprs[node->as.bin.rhs].kind == EXPR_IDENTIFIER ||
+         ast->exprs[node->as.bin.rhs].kind == EXPR_NUMBER)) {
+        const ExprNode *rhs = &ast->exprs[node->as.bin.rhs];
+
+        if (rhs->kind == EXPR_NUMBER) {
+            at = emit(code, back_edge ? BC_LOOP_SK : BC_BRANCH_NOT_SK);
+            code->code[at].k = rhs->as.number;
+        } else {
+            at = emit(code, back_edge ? BC_LOOP_SS : BC_BRANCH_NOT_SS);
+            code->code[at].b = rhs->slot;
+        }
+        code->code[at].a = ast->exprs[node->as.bin.lhs].slot;
+        code->code[at].sub = node->op;
+    } else {
+        compile_expr(code, ast, root);
+        at = emit(code, back_edge ? BC_LOOP_TRUE : BC_BRANCH_FALSE);
+    }
+    code->code[at].target = target;
+    code->code[at].ends_stmt = 1;
+    return at;
+}
+
+typedef struct {
+    int stmt;
+    int branch;           /* condition branch to patch */
+    int jump;             /* if/else: jump over the else body, or -1 */
+    int top;              /* while: first instruction of the body */
+} CompileFrame;
+
+/* Compile the while loop at statement `loop`, nested statements included.
+ * The loop is rotated: test once on entry, then test again at the bottom
+ * with a single back-edge instruction. */
+static LoopCode *compile_loop(const Ast *ast, int loop) {
+    const StmtNode *stmts = ast->stmts;
+    int loop_end = stmts[loop].end;
+    LoopCode *code = exec_alloc(sizeof(LoopCode));
+    CompileFrame *frames = exec_alloc((size_t)(loop_end - loop + 1) * sizeof(CompileFrame));
+    int depth = 0;
+    int i;
+
+    for (i = loop; ; i++) {
+        /* Close every construct whose body ends here, innermost first */
+        while (depth > 0 && stmts[frames[depth - 1].stmt].end <= i) {
+            CompileFrame *frame = &frames[--depth];
+            const StmtNode *stmt = &stmts[frame->stmt];
+
+            if (stmt->kind == STMT_WHILE) {
+                compile_cond(code, ast, stmt->expr, 1, frame->top);
+            }
+            if (frame->jump >= 0) {
+                code->code[frame->jump].target = code->count;
+            } else {
+                code->code[frame->branch].target = code->count;
+            }
+        }
+        if (i >= loop_end) {
+            break;
+        }
+
+        switch (stmts[i].kind) {
+            case STMT_DECL: {
+                int at = emit(code, BC_STORE_CONST);
+                code->code[at].a = stmts[i].slot;
+                code->code[at].ends_stmt = 1;
+                break;
+            }
+            case STMT_ASSIGN:
+                compile_assign(code, ast, stmts[i].slot, stmts[i].expr);
+                break;
+            case STMT_PRINT: {
+                int at;
+                compile_expr(code, ast, stmts[i].expr);
+                at = emit(code, BC_PRINT);
+                code->code[at].ends_stmt = 1;
+                break;
+            }
+            case STMT_IF:
+            case STMT_WHILE:
+                frames[depth].stmt = i;
+                frames[depth].branch = compile_cond(code, ast, stmts[i].expr, 0, -1);
+                frames[depth].jump = -1;
+                frames[depth].top = code->count;
+                depth++;
+                break;
+            case STMT_ELSE: {
+                /* End of the then-body: skip the else body, which starts here */
+                CompileFrame *frame = &frames[depth - 1];
+                frame->jump = emit(code, BC_JUMP);
+                code->code[frame->branch].target = code->count;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    emit(code, BC_EXIT);
+
+    free(frames);
+    return code;
+}
+
+static void free_loop(LoopCode *code) {
+    if (code != NULL) {
+        free(code->code);
+        free(code);
+    }
+}
+
+/* ---- Tier 1: bytecode interpreter ---- */
+
+#define BACK_EDGE()                                                    \
+    do {                                                               \
+        edges++;                                                       \
+        if (max_steps > 0 && ++steps > max_steps) {                    \
+            result = EXEC_STEP_LIMIT;                                  \
+            goto done;                                                 \
+        }                                                              \
+    } while (0)
+
+static ExecResult run_loop_code(Executor *ex, const LoopCode *loop) {
+    const Instr *code = loop->code;
+    long long *slots = ex->slots;
+    long long *sp;
+    long long ops = 0;
+    long long edges = 0;
+    long long steps = ex->steps;
+    long long max_steps = ex->options->max_steps;
+    ExecResult result = EXEC_OK;
+    int quiet = ex->options->quiet;
+    int pc = 0;
+
+    reserve_values(ex, loop->max_stack + 1);
+    sp = ex->values;
+
+    for (;;) {
+        const Instr *in = &code[pc++];
+        long long value;
+
+        ops += in->ends_stmt;
+        switch (in->op) {
+            case BC_CONST:
+                *sp++ = in->k;
+                break;
+            case BC_LOAD:
+                *sp++ = slots[in->a];
+                break;
+            case BC_NEG:
+                sp[-1] = wrap(0ull - (unsigned long long)sp[-1]);
+                break;
+            case BC_BINARY:
+                sp--;
+                if (!apply_binary(in->sub, sp[-1], sp[0], &sp[-1])) {
+                    ex->error_node = in->target;
+                    result = EXEC_RUNTIME_ERROR;
+                    goto done;
+                }
+                break;
+            case BC_STORE:
+                slots[in->a] = *--sp;
+                break;
+            case BC_PRINT:
+                value = *--sp;
+                if (!quiet) {
+                    printf("%lld\n", value);
+                }
+                break;
+            case BC_BRANCH_FALSE:
+                if (*--sp == 0) {
+                    pc = in->target;
+                }
+                break;
+            case BC_LOOP_TRUE:
+                BACK_EDGE();
+                if (*--sp != 0) {
+                    pc = in->target;
+                }
+                break;
+            case BC_JUMP:
+                pc = in->target;
+                break;
+            case BC_EXIT:
+                goto done;
+
+            case BC_STORE_CONST:
+                slots[in->a] = in->k;
+                break;
+            case BC_MOVE:
+                slots[in->a] = slots[in->b];
+                break;
+            case BC_ADD_CONST:
+                slots[in->a] = wrap((unsigned long long)slots[in->b] + (unsigned long long)in->k);
+                break;
+            case BC_BINARY_SS:
+                if (!apply_binary(in->sub, slots[in->b], slots[in->c], &slots[in->a])) {
+                    ex->error_node = in->target;
+                    result = EXEC_RUNTIME_ERROR;
+                    goto done;
+                }
+                break;
+            case BC_BINARY_SK:
+                if (!apply_binary(in->sub, slots[in->b], in->k, &slots[in->a])) {
+                    ex->error_node = in->target;
+                    result = EXEC_RUNTIME_ERROR;
+                    goto done;
+                }
+                break;
+            case BC_BRANCH_NOT_SS:
+                if (!compare(in->sub, slots[in->a], slots[in->b])) {
+                    pc = in->target;
+                }
+                break;
+            case BC_BRANCH_NOT_SK:
+                if (!compare(in->sub, slots[in->a], in->k)) {
+                    pc = in->target;
+                }
+                break;
+            case BC_LOOP_SS:
+                BACK_EDGE();
+                if (compare(in->sub, slots[in->a], slots[in->b])) {
+                    pc = in->target;
+                }
+                break;
+            case BC_LOOP_SK:
+                BACK_EDGE();
+                if (compare(in->sub, slots[in->a], in->k)) {
+                    pc = in->target;
+                }
+                break;
+        }
+    }
+
+done:
+    ex->steps = steps;
+    ex->stats->ops += ops;
+    ex->stats->back_edges += edges;
+    ex->stats->compiled_back_edges += edges;
+    return result;
+}
+
+/* ---- Driver ---- */
+
+static ExecResult enter_loop(Executor *ex, int loop) {
+    if (ex->compiled[loop] == NULL) {
+        double start = exec_now_ms();
+        ex->compiled[loop] = compile_loop(ex->ast, loop);
+        ex->stats->compile_ms += exec_now_ms() - start;
+        ex->stats->loops_compiled++;
+    }
+    return run_loop_code(ex, ex->compiled[loop]);
+}
+
+static ExecResult run_function(Executor *ex, const FunctionNode *function) {
+    const StmtNode *stmts = ex->ast->stmts;
+    long tier_up = ex->options->tier_up;
+    long long max_steps = ex->options->max_steps;
+    int loop_depth = 0;
+    int pc = function->body_start;
+    long long value;
+
+    for (;;) {
+        const StmtNode *stmt;
+
+        /* End of a loop body: the back-edge */
+        if (loop_depth > 0 && pc == stmts[ex->loops[loop_depth - 1]].end) {
+            int loop = ex->loops[--loop_depth];
+
+            ex->stats->back_edges++;
+            ex->loop_counts[loop]++;
+            if (max_steps > 0 && ++ex->steps > max_steps) {
+                return EXEC_STEP_LIMIT;
+            }
+            pc = loop;
+        }
+        if (pc >= function->body_end) {
+            return EXEC_OK;
+        }
+
+        stmt = &stmts[pc];
+        switch (stmt->kind) {
+            case STMT_DECL:
+                ex->slots[stmt->slot] = 0;
+                ex->stats->ops++;
+                pc++;
+                break;
+            case STMT_ASSIGN:
+            case STMT_PRINT:
+                if (!eval_expr(ex, stmt->expr, &value)) {
+                    return EXEC_RUNTIME_ERROR;
+                }
+                if (stmt->kind == STMT_ASSIGN) {
+                    ex->slots[stmt->slot] = value;
+                } else if (!ex->options->quiet) {
+                    printf("%lld\n", value);
+                }
+                ex->stats->ops++;
+                pc++;
+                break;
+            case STMT_IF:
+                if (!eval_expr(ex, stmt->expr, &value)) {
+                    return EXEC_RUNTIME_ERROR;
+                }
+                ex->stats->ops++;
+                if (value != 0) {
+                    pc++;
+                } else {
+                    pc = stmt->else_branch >= 0 ? stmt->else_branch + 1 : stmt->end;
+                }
+                break;
+            case STMT_ELSE:
+                pc = stmt->end; /* the then-body ran: skip the else body */
+                break;
+            case STMT_WHILE:
+                if (tier_up >= 0 && ex->loop_counts[pc] >= tier_up) {
+                    ExecResult result = enter_loop(ex, pc);
+                    if (result != EXEC_OK) {
+                        return result;
+                    }
+                    pc = stmt->end;
+                    break;
+                }
+                if (!eval_expr(ex, stmt->expr, &value)) {
+                    return EXEC_RUNTIME_ERROR;
+                }
+                ex->stats->ops++;
+                if (value != 0) {
+                    ex->loops[loop_depth++] = pc;
+                    pc++;
+                } else {
+                    pc = stmt->end;
+                }
+                break;
+            default:
+                pc++;
+                break;
+        }
+    }
+}
+
+void exec_options_init(ExecOptions *options) {
+    options->tier_up = EXEC_TIER_UP_BACKEDGES;
+    options->max_steps = EXEC_MAX_STEPS;
+    options->quiet = 0;
+}
+
+ExecResult execute_program(const Ast *ast, int slot_count, const ExecOptions *options,
+                           ExecStats *stats) {
+    Executor ex;
+    const FunctionNode *entry = NULL;
+    ExecResult result = EXEC_OK;
+    int i;
+
+    memset(stats, 0, sizeof(*stats));
+    for (i = 0; i < ast->function_count; i++) {
+        if (strcmp(ast_name(ast, ast->functions[i].name), "main") == 0) {
+            entry = &ast->functions[i];
+            break;
+        }
+    }
+    if (entry == NULL && ast->function_count > 0) {
+        entry = &ast->functions[0];
+    }
+    if (entry == NULL) {
+        return EXEC_OK;
+    }
+
+    memset(&ex, 0, sizeof(ex));
+    ex.ast = ast;
+    ex.options = options;
+    ex.stats = stats;
+    ex.slots = exec_alloc((size_t)slot_count * sizeof(long long));
+    ex.loop_counts = exec_alloc((size_t)ast->stmt_count * sizeof(int));
+    ex.compiled = exec_alloc((size_t)ast->stmt_count * sizeof(LoopCode *));
+    ex.loops = exec_alloc((size_t)ast->stmt_count * sizeof(int));
+    ex.error_node = -1;
+
+    result = run_function(&ex, entry);
+    if (result == EXEC_RUNTIME_ERROR) {
+        const ExprNode *node = &ast->exprs[ex.error_node];
+        printf("Runtime error: division by zero at line %d, column %d\n", node->line, node->column);
+    } else if (result == EXEC_STEP_LIMIT) {
+        printf("Execution stopped: more than %lld loop iterations\n", options->max_steps);
+    }
+
+    for (i = 0; i < ast->stmt_count; i++) {
+        free_loop(ex.compiled[i]);
+    }
+    free(ex.compiled);
+    free(ex.loop_counts);
+    free(ex.loops);
+    free(ex.slots);
+    free(ex.values);
+    return result;
+}
+
+/* ---- Benchmark ---- */
+
+void exec_benchmark(const Ast *ast, int slot_count, const ExecOptions *options, FILE *out) {
+    static const char *const names[] = { "interpreter", "tiered", "bytecode" };
+    ExecOptions tier_options[3];
+    int t;
+
+    for (t = 0; t < 3; t++) {
+        tier_options[t] = *options;
+        tier_options[t].quiet = 1;
+    }
+    tier_options[0].tier_up = -1;
+    tier_options[2].tier_up = 0;
+
+    fprintf(out, "Execution benchmark (tier-up after %ld back-edges):\n", options->tier_up);
+    fprintf(out, "  %-12s %12s %12s %8s %14s %14s\n",
+            "tier", "first run", "compile", "loops", "ops/s", "iterations/s");
+    for (t = 0; t < 3; t++) {
+        ExecStats stats;
+        double start = exec_now_ms();
+        double first_ms, total_ms;
+        double compile_ms;
+        long long ops = 0, edges = 0;
+        int loops;
+        int runs = 0;
+
+        /* First run: what a one-off program pays, compile time included */
+        execute_program(ast, slot_count, &tier_options[t], &stats);
+        first_ms = exec_now_ms() - start;
+        compile_ms = stats.compile_ms;
+        loops = stats.loops_compiled;
+
+        /* Steady state: repeat until the measurement is long enough */
+        start = exec_now_ms();
+        do {
+            execute_program(ast, slot_count, &tier_options[t], &stats);
+            ops += stats.ops;
+            edges += stats.back_edges;
+            runs++;
+            total_ms = exec_now_ms() - start;
+        } while (total_ms < EXEC_BENCH_MS || runs < 3);
+
+        fprintf(out, "  %-12s %9.3f ms %9.3f ms %8d %14.0f %14.0f\n",
+                names[t], first_ms, compile_ms, loops,
+                ops * 1000.0 / total_ms, edges * 1000.0 / total_ms);
+    }
+}
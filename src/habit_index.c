@@ -0,0 +1,190 @@
+// Aggregated habit counts shared by --habits and the profile cache
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "lexer.h"
+#include "symbol_table.h"
+#include "error_tracker.h"
+#include "habit_index.h"
+
+#define INDEX_MAGIC "HASCIDX 3"
+#define RECORD_MAX 512
+
+void tally_init(Tally *tally) {
+    symbol_table_init(&tally->keys);
+    tally->counts = NULL;
+    tally->capacity = 0;
+}
+
+void tally_free(Tally *tally) {
+    symbol_table_free(&tally->keys);
+    free(tally->counts);
+    tally->counts = NULL;
+    tally->capacity = 0;
+}
+
+void tally_add(Tally *tally, const char *key, unsigned long amount) {
+    int id = symbol_intern(&tally->keys, key);
+
+    if (id >= tally->capacity) {
+        int new_capacity = tally->capacity ? tally->capacity * 2 : 256;
+        unsigned long *grown;
+
+        while (new_capacity <= id) {
+            new_capacity *= 2;
+        }
+        grown = realloc(tally->counts, (size_t)new_capacity * sizeof(unsigned long));
+        if (grown == NULL) {
+            fprintf(stderr, "Error: Out of memory while counting habits\n");
+            exit(1);
+        }
+        memset(grown + tally->capacity, 0,
+               (size_t)(new_capacity - tally->capacity) * sizeof(unsigned long));
+        tally->counts = grown;
+        tally->capacity = new_capacity;
+    }
+
+    tally->counts[id] += amount;
+}
+
+unsigned long tally_count(Tally *tally, const char *key) {
+    /* Interning an unseen key leaves it at count 0 */
+    int id = symbol_intern(&tally->keys, key);
+    return id < tally->capacity ? tally->counts[id] : 0;
+}
+
+const char *tally_key(const Tally *tally, int id) {
+    return symbol_spelling(&tally->keys, id);
+}
+
+int tally_size(const Tally *tally) {
+    return tally->keys.intern_count;
+}
+
+void habit_index_init(HabitIndex *index) {
+    tally_init(&index->mistakes);
+    index->events = 0;
+    index->log_offset = 0;
+}
+
+void habit_index_free(HabitIndex *index) {
+    tally_free(&index->mistakes);
+    index->events = 0;
+    index->log_offset = 0;
+}
+
+void habit_index_add(HabitIndex *index, const ErrorRecord *record, unsigned long amount) {
+    char key[RECORD_MAX * 2];
+
+    /* The log's own layout, so error_record_parse() reads keys back */
+    snprintf(key, sizeof(key), "%d|%d|%d|%d|%s|%s", (int)record->code,
+             (int)record->actual_type, record->line, record->column, record->actual_lexeme,
+             record->file);
+    tally_add(&index->mistakes, key, amount);
+    index->events += amount;
+}
+
+static void strip_newline(char *line) {
+    size_t len = strlen(line);
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+        line[--len] = '\0';
+    }
+}
+
+int habit_index_load(HabitIndex *index, const char *path, long log_size,
+                     HabitRecordFn each, void *arg) {
+    FILE *file = fopen(path, "rb");
+    char line[RECORD_MAX * 2 + 32];
+    unsigned long events;
+    long offset;
+
+    if (file == NULL) {
+        return 0;
+    }
+
+    if (fgets(line, sizeof(line), file) == NULL ||
+        strncmp(line, INDEX_MAGIC " ", sizeof(INDEX_MAGIC)) != 0 ||
+        sscanf(line + sizeof(INDEX_MAGIC), "%ld %lu", &offset, &events) != 2 ||
+        offset > log_size) {
+        /* Unknown format, or the log was reset since the index was written */
+        fclose(file);
+        return 0;
+    }
+
+    /* events is recomputed from the mistakes, which are all that is stored */
+    while (fgets(line, sizeof(line), file) != NULL) {
+        ErrorRecord record;
+        unsigned long count;
+        int key_start;
+
+        strip_newline(line);
+        if (sscanf(line, "M %lu %n", &count, &key_start) >= 1 &&
+            error_record_parse(line + key_start, &record)) {
+            habit_index_add(index, &record, count);
+            if (each != NULL) {
+                each(arg, &record, count);
+            }
+        }
+    }
+
+    fclose(file);
+    index->log_offset = offset;
+    return 1;
+}
+
+void habit_index_read_log(HabitIndex *index, FILE *log, HabitRecordFn each, void *arg) {
+    char line[RECORD_MAX];
+    int skipping = 0;
+
+    fseek(log, index->log_offset, SEEK_SET);
+    while (fgets(line, sizeof(line), log) != NULL) {
+        size_t len = strlen(line);
+        ErrorRecord record;
+
+        if (len == 0 || line[len - 1] != '\n') {
+            if (feof(log)) {
+                break; /* partial last record, still being written */
+            }
+            skipping = 1; /* overlong record: drop it */
+            continue;
+        }
+        index->log_offset = ftell(log);
+        if (skipping) {
+            skipping = 0;
+            continue;
+        }
+        strip_newline(line);
+        if (error_record_parse(line, &record)) {
+            habit_index_add(index, &record, 1);
+            if (each != NULL) {
+                each(arg, &record, 1);
+            }
+        }
+    }
+}
+
+void habit_index_save(const HabitIndex *index, const char *path) {
+    char tmp_path[512];
+    FILE *file;
+    int i;
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    file = fopen(tmp_path, "wb");
+    if (file == NULL) {
+        return;
+    }
+
+    fprintf(file, "%s %ld %lu\n", INDEX_MAGIC, index->log_offset, index->events);
+    for (i = 0; i < tally_size(&index->mistakes); i++) {
+        fprintf(file, "M %lu %s\n", index->mistakes.counts[i], tally_key(&index->mistakes, i));
+    }
+
+    if (fclose(file) != 0) {
+        remove(tmp_path);
+        return;
+    }
+    remove(path);
+    rename(tmp_path, path);
+}
@@ -0,0 +1,542 @@
+// Approximate habit counts (count-min sketch + Bloom filter)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "lexer.h"
+#include "symbol_table.h"
+#include "error_tracker.h"
+#include "profile_store.h"
+#include "habit_sketch.h"
+
+#define SKETCH_MAGIC "HASCCMS"
+#define HEADER_SIZE 32
+#define COUNTER_MAX 0xffffffffu
+#define RECORD_MAX 512
+#define MAX_DEPTH 64
+
+typedef struct {
+    FILE *file;
+    unsigned int width;
+    unsigned int depth;
+    unsigned int bloom_bytes;
+    unsigned char *bloom;     /* in-memory copy of the filter */
+} Sketch;
+
+static Sketch sketch;
+static int sketch_active = 0;
+static int sketch_requested = 0;    /* --sketch given: follow profile changes */
+static size_t sketch_request_bytes = 0;
+
+/* ---- Hashing ---- */
+
+typedef struct {
+    unsigned long long row;     /* counter positions */
+    unsigned long long bloom;   /* filter positions */
+} Fingerprint;
+
+static unsigned long long fnv_bytes(unsigned long long hash, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/* splitmix64 finaliser: a second, independent-looking hash from the first */
+static unsigned long long mix64(unsigned long long x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+/* Same fields threshold_check() compares: code, token type, position, lexeme */
+static Fingerprint fingerprint(ErrorCode code, TokenType type, int line, int column,
+                               const char *lexeme) {
+    int fields[4];
+    Fingerprint print;
+    unsigned long long hash = 14695981039346656037ull;
+
+    fields[0] = (int)code;
+    fields[1] = (int)type;
+    fields[2] = line;
+    fields[3] = column;
+    hash = fnv_bytes(hash, fields, sizeof(fields));
+    hash = fnv_bytes(hash, lexeme, strlen(lexeme));
+    print.row = hash;
+    print.bloom = mix64(hash);
+    return print;
+}
+
+/* Double hashing: probe i lands on (h1 + i*h2) mod range */
+static unsigned int probe(unsigned long long hash, unsigned int i, unsigned int range) {
+    unsigned int h1 = (unsigned int)hash;
+    unsigned int h2 = (unsigned int)(hash >> 32) | 1u;
+    return (unsigned int)((h1 + (unsigned long long)i * h2) % range);
+}
+
+/* ---- File access ---- */
+
+static void put_u32(unsigned char *out, unsigned int value) {
+    out[0] = (unsigned char)value;
+    out[1] = (unsigned char)(value >> 8);
+    out[2] = (unsigned char)(value >> 16);
+    out[3] = (unsigned char)(value >> 24);
+}
+
+static unsigned int get_u32(const unsigned char *in) {
+    return (unsigned int)in[0] | ((unsigned int)in[1] << 8) |
+           ((unsigned int)in[2] << 16) | ((unsigned int)in[3] << 24);
+}
+
+static long counter_offset(unsigned int row, unsigned int column) {
+    return HEADER_SIZE + (long)sketch.bloom_bytes +
+           ((long)row * sketch.width + column) * 4;
+}
+
+static int read_at(long offset, void *data, size_t size) {
+    return fseek(sketch.file, offset, SEEK_SET) == 0 &&
+           fread(data, 1, size, sketch.file) == size;
+}
+
+static int write_at(long offset, const void *data, size_t size) {
+    return fseek(sketch.file, offset, SEEK_SET) == 0 &&
+           fwrite(data, 1, size, sketch.file) == size;
+}
+
+/* ---- Building a new sketch ---- */
+
+typedef struct {
+    unsigned int width;
+    unsigned int depth;
+    unsigned int bloom_bytes;
+    unsigned char *bloom;
+    unsigned int *counters;
+    unsigned long long events;
+} SketchImage;
+
+/* Conservative update: raise only the counters that equal the minimum */
+static void image_add(SketchImage *image, Fingerprint print) {
+    unsigned int smallest = COUNTER_MAX;
+    unsigned int i;
+
+    for (i = 0; i < HABIT_SKETCH_HASHES; i++) {
+        unsigned int bit = probe(print.bloom, i, image->bloom_bytes * 8u);
+        image->bloom[bit >> 3] |= (unsigned char)(1u << (bit & 7));
+    }
+    for (i = 0; i < image->depth; i++) {
+        unsigned int value = image->counters[i * image->width + probe(print.row, i, image->width)];
+        if (value < smallest) {
+            smallest = value;
+        }
+    }
+    if (smallest < COUNTER_MAX) {
+        for (i = 0; i < image->depth; i++) {
+            unsigned int *counter = &image->counters[i * image->width + probe(print.row, i, image->width)];
+            if (*counter == smallest) {
+                *counter = smallest + 1;
+            }
+        }
+    }
+    image->events++;
+}
+
+/* Fold the exact history into a fresh image so enabling the sketch keeps
+ * every habit already on record */
+static void image_seed(SketchImage *image) {
+    FILE *log;
+    char line[RECORD_MAX];
+
+    profile_store_flush(); /* records still held in the profile cache */
+    log = fopen(profile_path(PROFILE_LOG), "r");
+    if (log == NULL) {
+        return;
+    }
+    while (fgets(line, sizeof(line), log) != NULL) {
+        ErrorRecord record;
+
+        line[strcspn(line, "\r\n")] = '\0';
+        if (error_record_parse(line, &record)) {
+            image_add(image, fingerprint(record.code, record.actual_type, record.line,
+                                         record.column, record.actual_lexeme));
+        }
+    }
+    fclose(log);
+}
+
+static int create_sketch(size_t bytes) {
+    SketchImage image;
+    unsigned char header[HEADER_SIZE];
+    unsigned char *row;
+    char tmp_path[512];
+    FILE *file;
+    size_t cells;
+    size_t i;
+    int ok;
+
+    if (bytes < HABIT_SKETCH_MIN_BYTES) {
+        bytes = HABIT_SKETCH_MIN_BYTES;
+    }
+    if (bytes > HABIT_SKETCH_MAX_BYTES) {
+        bytes = HABIT_SKETCH_MAX_BYTES;
+    }
+    image.depth = HABIT_SKETCH_DEPTH;
+    image.bloom_bytes = (unsigned int)(bytes / 8);
+    image.width = (unsigned int)((bytes - HEADER_SIZE - image.bloom_bytes) / (4u * image.depth));
+    image.events = 0;
+    cells = (size_t)image.width * image.depth;
+    image.bloom = calloc(image.bloom_bytes, 1);
+    image.counters = calloc(cells, sizeof(unsigned int));
+    row = malloc(4u * image.width);
+    if (image.bloom == NULL || image.counters == NULL || row == NULL) {
+        fprintf(stderr, "Error: Out of memory while building habit sketch\n");
+        exit(1);
+    }
+    image_seed(&image);
+
+    memcpy(header, SKETCH_MAGIC, 8);
+    put_u32(header + 8, SKETCH_VERSION);
+    put_u32(header + 12, image.width);
+    put_u32(header + 16, image.depth);
+    put_u32(header + 20, image.bloom_bytes);
+    put_u32(header + 24, (unsigned int)image.events);
+    put_u32(header + 28, (unsigned int)(image.events >> 32));
+
+    /* Write under a temporary name so a reader never sees half a sketch */
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", profile_path(PROFILE_SKETCH));
+    file = fopen(tmp_path, "wb");
+    ok = file != NULL &&
+         fwrite(header, 1, HEADER_SIZE, file) == HEADER_SIZE &&
+         fwrite(image.bloom, 1, image.bloom_bytes, file) == image.bloom_bytes;
+    for (i = 0; ok && i < image.depth; i++) {
+        unsigned int j;
+        for (j = 0; j < image.width; j++) {
+            put_u32(row + 4u * j, image.counters[i * image.width + j]);
+        }
+        ok = fwrite(row, 4, image.width, file) == image.width;
+    }
+    if (file != NULL && fclose(file) != 0) {
+        ok = 0;
+    }
+    if (ok) {
+        remove(profile_path(PROFILE_SKETCH));
+        ok = rename(tmp_path, profile_path(PROFILE_SKETCH)) == 0;
+    } else {
+        remove(tmp_path);
+    }
+
+    free(image.bloom);
+    free(image.counters);
+    free(row);
+    return ok;
+}
+
+/* ---- Open / close ---- */
+
+static int open_sketch(void) {
+    unsigned char header[HEADER_SIZE];
+    long expected;
+
+    sketch.file = fopen(profile_path(PROFILE_SKETCH), "r+b");
+    if (sketch.file == NULL) {
+        return 0;
+    }
+    profile_lock_file(sketch.file, 0);
+    if (fread(header, 1, HEADER_SIZE, sketch.file) != HEADER_SIZE ||
+        memcmp(header, SKETCH_MAGIC, 8) != 0 || get_u32(header + 8) != SKETCH_VERSION) {
+        profile_unlock_file(sketch.file);
+        fclose(sketch.file);
+        return 0;
+    }
+    sketch.width = get_u32(header + 12);
+    sketch.depth = get_u32(header + 16);
+    sketch.bloom_bytes = get_u32(header + 20);
+    expected = counter_offset(sketch.depth, 0);
+
+    sketch.bloom = malloc(sketch.bloom_bytes > 0 ? sketch.bloom_bytes : 1);
+    if (sketch.bloom == NULL) {
+        fprintf(stderr, "Error: Out of memory while loading habit sketch\n");
+        exit(1);
+    }
+    if (sketch.width == 0 || sketch.depth == 0 || sketch.depth > MAX_DEPTH || sketch.bloom_bytes == 0 ||
+        fread(sketch.bloom, 1, sketch.bloom_bytes, sketch.file) != sketch.bloom_bytes ||
+        fseek(sketch.file, 0, SEEK_END) != 0 || ftell(sketch.file) != expected) {
+        profile_unlock_file(sketch.file);
+        fclose(sketch.file);
+        free(sketch.bloom);
+        return 0;
+    }
+    profile_unlock_file(sketch.file);
+    return 1;
+}
+
+void habit_sketch_enable(size_t bytes) {
+    /* Before anything is requested, so selecting the default profile here
+     * does not retarget back into this function */
+    int dir_ready = profile_prepare_dir() == 0;
+
+    sketch_requested = 1;
+    sketch_request_bytes = bytes;
+    if (sketch_active) {
+        return;
+    }
+    if (!open_sketch()) {
+        if (!dir_ready ||
+            !create_sketch(bytes > 0 ? bytes : HABIT_SKETCH_BYTES) || !open_sketch()) {
+            return; /* no data/ directory: stay on exact counts */
+        }
+    }
+    sketch_active = 1;
+}
+
+void habit_sketch_retarget(void) {
+    if (sketch_requested) {
+        habit_sketch_close();
+        habit_sketch_enable(sketch_request_bytes);
+    }
+}
+
+int habit_sketch_enabled(void) {
+    return sketch_active;
+}
+
+void habit_sketch_close(void) {
+    if (!sketch_active) {
+        return;
+    }
+    fclose(sketch.file);
+    free(sketch.bloom);
+    sketch_active = 0;
+}
+
+/* ---- Counting ---- */
+
+void habit_sketch_add(ErrorCode code, const Token *token) {
+    Fingerprint print = fingerprint(code, token->type, token->line, token->column, token->lexeme);
+    unsigned char cell[4];
+    unsigned int values[MAX_DEPTH];
+    unsigned int smallest = COUNTER_MAX;
+    unsigned long long events;
+    unsigned int i;
+
+    if (!sketch_active) {
+        return;
+    }
+    profile_lock_file(sketch.file, 1);
+
+    /* Merge with what other processes set rather than trusting our copy,
+     * so no bit is ever cleared */
+    for (i = 0; i < HABIT_SKETCH_HASHES; i++) {
+        unsigned int bit = probe(print.bloom, i, sketch.bloom_bytes * 8u);
+        long offset = HEADER_SIZE + (long)(bit >> 3);
+        unsigned char byte;
+
+        if (read_at(offset, &byte, 1)) {
+            byte |= (unsigned char)(1u << (bit & 7));
+            write_at(offset, &byte, 1);
+            sketch.bloom[bit >> 3] = byte;
+        }
+    }
+
+    for (i = 0; i < sketch.depth; i++) {
+        values[i] = read_at(counter_offset(i, probe(print.row, i, sketch.width)), cell, 4)
+                        ? get_u32(cell) : 0;
+        if (values[i] < smallest) {
+            smallest = values[i];
+        }
+    }
+    if (smallest < COUNTER_MAX) {
+        put_u32(cell, smallest + 1);
+        for (i = 0; i < sketch.depth; i++) {
+            if (values[i] == smallest) {
+                write_at(counter_offset(i, probe(print.row, i, sketch.width)), cell, 4);
+            }
+        }
+    }
+
+    if (read_at(24, cell, 4)) {
+        unsigned char high[4];
+        read_at(28, high, 4);
+        events = ((unsigned long long)get_u32(high) << 32 | get_u32(cell)) + 1;
+        put_u32(cell, (unsigned int)events);
+        put_u32(high, (unsigned int)(events >> 32));
+        write_at(24, cell, 4);
+        write_at(28, high, 4);
+    }
+
+    profile_unlock_file(sketch.file);
+}
+
+static int bloom_contains(Fingerprint print) {
+    unsigned int i;
+
+    for (i = 0; i < HABIT_SKETCH_HASHES; i++) {
+        unsigned int bit = probe(print.bloom, i, sketch.bloom_bytes * 8u);
+        if ((sketch.bloom[bit >> 3] & (1u << (bit & 7))) == 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static unsigned long estimate(Fingerprint print) {
+    unsigned char cell[4];
+    unsigned int smallest = COUNTER_MAX;
+    unsigned int i;
+
+    /* A mistake is always added before it is checked, and adding refreshes
+     * these bits from the file, so a miss here is a true "never seen" */
+    if (!bloom_contains(print)) {
+        return 0;
+    }
+    profile_lock_file(sketch.file, 0);
+    for (i = 0; i < sketch.depth; i++) {
+        unsigned int value = read_at(counter_offset(i, probe(print.row, i, sketch.width)), cell, 4)
+                                 ? get_u32(cell) : COUNTER_MAX;
+        if (value < smallest) {
+            smallest = value;
+        }
+    }
+    profile_unlock_file(sketch.file);
+    return smallest;
+}
+
+unsigned long habit_sketch_estimate(ErrorCode code, const Token *token) {
+    if (!sketch_active) {
+        return 0;
+    }
+    return estimate(fingerprint(code, token->type, token->line, token->column, token->lexeme));
+}
+
+/* ---- Audit ---- */
+
+int habit_sketch_audit(FILE *out) {
+    SymbolTable keys;
+    unsigned long *exact = NULL;
+    Fingerprint *prints = NULL;
+    int capacity = 0;
+    unsigned long events = 0;
+    unsigned long under = 0, matched = 0, false_habits = 0, beyond = 0;
+    unsigned long max_over = 0;
+    double total_over = 0.0;
+    double bound;
+    double delta = 1.0;      /* e^-d: chance an estimate exceeds the bound */
+    unsigned long long sketch_events;
+    unsigned char cell[8];
+    char line[RECORD_MAX];
+    char key[RECORD_MAX + 64];
+    FILE *log;
+    int was_active = sketch_active;
+    int distinct;
+    int i;
+
+    if (!was_active && !open_sketch()) {
+        return 1;
+    }
+    sketch_active = 1;
+    profile_store_flush();
+    log = fopen(profile_path(PROFILE_LOG), "r");
+    if (log == NULL) {
+        if (!was_active) {
+            habit_sketch_close();
+        }
+        return 1;
+    }
+
+    /* Exact counts per fingerprint, keyed through the interner */
+    symbol_table_init(&keys);
+    while (fgets(line, sizeof(line), log) != NULL) {
+        ErrorRecord record;
+        int id;
+
+        line[strcspn(line, "\r\n")] = '\0';
+        if (!error_record_parse(line, &record)) {
+            continue;
+        }
+        snprintf(key, sizeof(key), "%d|%d|%d|%d|%s", (int)record.code, (int)record.actual_type,
+                 record.line, record.column, record.actual_lexeme);
+        id = symbol_intern(&keys, key);
+        if (id >= capacity) {
+            int new_capacity = capacity ? capacity * 2 : 256;
+            while (new_capacity <= id) {
+                new_capacity *= 2;
+            }
+            exact = realloc(exact, (size_t)new_capacity * sizeof(*exact));
+            prints = realloc(prints, (size_t)new_capacity * sizeof(*prints));
+            if (exact == NULL || prints == NULL) {
+                fprintf(stderr, "Error: Out of memory while auditing habit sketch\n");
+                exit(1);
+            }
+            memset(exact + capacity, 0, (size_t)(new_capacity - capacity) * sizeof(*exact));
+            capacity = new_capacity;
+        }
+        if (exact[id] == 0) {
+            prints[id] = fingerprint(record.code, record.actual_type, record.line,
+                                     record.column, record.actual_lexeme);
+        }
+        exact[id]++;
+        events++;
+    }
+    fclose(log);
+    distinct = keys.intern_count;
+
+    read_at(24, cell, 8);
+    sketch_events = (unsigned long long)get_u32(cell + 4) << 32 | get_u32(cell);
+    bound = 2.718281828 * (double)sketch_events / sketch.width;
+    for (i = 0; i < (int)sketch.depth; i++) {
+        delta /= 2.718281828;
+    }
+
+    for (i = 0; i < distinct; i++) {
+        unsigned long approx = estimate(prints[i]);
+
+        if (approx < exact[i]) {
+            under++;
+        } else {
+            unsigned long over = approx - exact[i];
+            if (over == 0) {
+                matched++;
+            }
+            if (over > max_over) {
+                max_over = over;
+            }
+            total_over += (double)over;
+            if ((double)over > bound) {
+                beyond++;
+            }
+            if (exact[i] < HABIT_THRESHOLD && approx >= HABIT_THRESHOLD) {
+                false_habits++;
+            }
+        }
+    }
+
+    fprintf(out, "Habit sketch audit (%s):\n", profile_path(PROFILE_SKETCH));
+    fprintf(out, "  geometry:        %u x %u counters, %u filter bytes (%ld bytes total)\n",
+            sketch.depth, sketch.width, sketch.bloom_bytes, counter_offset(sketch.depth, 0));
+    fprintf(out, "  events:          %lu in the log, %llu in the sketch%s\n", events, sketch_events,
+            sketch_events > events ? "  (runs under --sketch are not logged)" : "");
+    fprintf(out, "  fingerprints:    %d distinct\n", distinct);
+    fprintf(out, "  exact estimates: %lu (%.1f%%)\n", matched,
+            distinct > 0 ? 100.0 * (double)matched / distinct : 100.0);
+    fprintf(out, "  over-estimate:   max %lu, mean %.3f, bound e*N/w = %.2f\n", max_over,
+            distinct > 0 ? total_over / distinct : 0.0, bound);
+    fprintf(out, "  beyond bound:    %lu (%.2f%%, at most e^-d = %.2f%% expected)\n", beyond,
+            distinct > 0 ? 100.0 * (double)beyond / distinct : 0.0, 100.0 * delta);
+    fprintf(out, "  false habits:    %lu (estimate >= %d, exact count below)\n", false_habits,
+            HABIT_THRESHOLD);
+    fprintf(out, "  under-reports:   %lu%s\n", under, under > 0 ? "  <-- sketch is stale or damaged" : "");
+
+    symbol_table_free(&keys);
+    free(exact);
+    free(prints);
+    if (!was_active) {
+        habit_sketch_close();
+    }
+    return 0;
+}
@@ -0,0 +1,303 @@
+// Habit history report (--habits)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "lexer.h"
+#include "symbol_table.h"
+#include "error_tracker.h"
+#include "habit_index.h"
+#include "profile_store.h"
+#include "habits.h"
+
+#define RECORD_MAX 512
+
+typedef struct {
+    HabitIndex index;     /* mistakes as logged, persisted as PROFILE_INDEX */
+    Tally fingerprints;   /* code|type|line|column|lexeme, what the threshold counts */
+    Tally kinds;          /* code */
+    Tally file_kinds;     /* file|code */
+} HabitCounts;
+
+/* Every tally but the mistakes is derived from them */
+static void count_record(void *arg, const ErrorRecord *record, unsigned long amount) {
+    HabitCounts *habits = arg;
+    char key[RECORD_MAX * 2];
+    const char *name = error_code_name(record->code);
+
+    snprintf(key, sizeof(key), "%d|%d|%d|%d|%s", (int)record->code, (int)record->actual_type,
+             record->line, record->column, record->actual_lexeme);
+    tally_add(&habits->fingerprints, key, amount);
+
+    tally_add(&habits->kinds, name, amount);
+
+    snprintf(key, sizeof(key), "%s|%s", record->file[0] != '\0' ? record->file : "<unknown>",
+             name);
+    tally_add(&habits->file_kinds, key, amount);
+}
+
+/* Read a mistakes key back into its fields; `buffer` holds the strings */
+static void mistake_fields(const HabitCounts *habits, int id, char *buffer, size_t size,
+                           ErrorRecord *record) {
+    snprintf(buffer, size, "%s", tally_key(&habits->index.mistakes, id));
+    if (!error_record_parse(buffer, record)) {
+        memset(record, 0, sizeof(*record));
+        record->actual_lexeme = record->file = "";
+    }
+}
+
+/* Times this mistake was seen in any file, as threshold_check() counts it */
+static unsigned long fingerprint_count(HabitCounts *habits, const ErrorRecord *record) {
+    char key[RECORD_MAX * 2];
+
+    snprintf(key, sizeof(key), "%d|%d|%d|%d|%s", (int)record->code, (int)record->actual_type,
+             record->line, record->column, record->actual_lexeme);
+    return tally_count(&habits->fingerprints, key);
+}
+
+static const Tally *sort_tally;
+
+/* qsort order: higher count first, then key, so ties are stable across runs */
+static int compare_sorted(const void *a, const void *b) {
+    int ia = *(const int *)a;
+    int ib = *(const int *)b;
+
+    if (sort_tally->counts[ia] != sort_tally->counts[ib]) {
+        return sort_tally->counts[ia] > sort_tally->counts[ib] ? -1 : 1;
+    }
+    return strcmp(tally_key(sort_tally, ia), tally_key(sort_tally, ib));
+}
+
+/* Indices of the tally's keys, most frequent first */
+static int *sorted_ids(const Tally *tally) {
+    int n = tally_size(tally);
+    int *ids = malloc((size_t)(n > 0 ? n : 1) * sizeof(int));
+    int i;
+
+    if (ids == NULL) {
+        fprintf(stderr, "Error: Out of memory while building habit report\n");
+        exit(1);
+    }
+    for (i = 0; i < n; i++) {
+        ids[i] = i;
+    }
+    sort_tally = tally;
+    qsort(ids, (size_t)n, sizeof(int), compare_sorted);
+    return ids;
+}
+
+static void print_json_string(FILE *out, const char *text) {
+    fputc('"', out);
+    for (; *text != '\0'; text++) {
+        unsigned char c = (unsigned char)*text;
+        if (c == '"' || c == '\\') {
+            fprintf(out, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void print_mistake(FILE *out, HabitCounts *habits, int rank, int id) {
+    char buffer[RECORD_MAX * 2];
+    ErrorRecord record;
+
+    mistake_fields(habits, id, buffer, sizeof(buffer), &record);
+    fprintf(out, "  %2d. %5lux  %-26s %s '%s' at %s:%d:%d%s\n", rank,
+            habits->index.mistakes.counts[id], error_code_name(record.code),
+            token_type_to_string(record.actual_type), record.actual_lexeme,
+            record.file[0] != '\0' ? record.file : "<unknown>", record.line, record.column,
+            fingerprint_count(habits, &record) >= HABIT_THRESHOLD ? "  (habitual)" : "");
+}
+
+/* Code of every mistake, so per-kind lists need not re-parse keys */
+static int *mistake_codes(HabitCounts *habits) {
+    int n = tally_size(&habits->index.mistakes);
+    int *codes = malloc((size_t)(n > 0 ? n : 1) * sizeof(int));
+    int i;
+
+    if (codes == NULL) {
+        fprintf(stderr, "Error: Out of memory while building habit report\n");
+        exit(1);
+    }
+    for (i = 0; i < n; i++) {
+        codes[i] = atoi(tally_key(&habits->index.mistakes, i));
+    }
+    return codes;
+}
+
+static void print_text(FILE *out, HabitCounts *habits, int top_n) {
+    int *ids = sorted_ids(&habits->index.mistakes);
+    int *kind_ids = sorted_ids(&habits->kinds);
+    int *codes = mistake_codes(habits);
+    int n = tally_size(&habits->index.mistakes);
+    int kinds = tally_size(&habits->kinds);
+    int i, k;
+
+    fprintf(out, "Habit report: %lu errors, %d distinct mistakes\n\n",
+            habits->index.events, n);
+
+    fprintf(out, "Top %d mistakes:\n", top_n < n ? top_n : n);
+    for (i = 0; i < n && i < top_n; i++) {
+        print_mistake(out, habits, i + 1, ids[i]);
+    }
+
+    fprintf(out, "\nErrors by kind:\n");
+    for (k = 0; k < kinds; k++) {
+        const char *name = tally_key(&habits->kinds, kind_ids[k]);
+        int code = error_code_from_name(name);
+
+        fprintf(out, "  %6lu  %-26s %s\n", habits->kinds.counts[kind_ids[k]], name,
+                code >= 0 ? error_message((ErrorCode)code) : "");
+    }
+
+    fprintf(out, "\nTop %d mistakes per kind:\n", top_n);
+    for (k = 0; k < kinds; k++) {
+        int code = error_code_from_name(tally_key(&habits->kinds, kind_ids[k]));
+        int rank = 0;
+
+        fprintf(out, "  %s:\n", tally_key(&habits->kinds, kind_ids[k]));
+        for (i = 0; i < n && rank < top_n; i++) {
+            if (codes[ids[i]] == code) {
+                print_mistake(out, habits, ++rank, ids[i]);
+            }
+        }
+    }
+    free(codes);
+    free(kind_ids);
+    free(ids);
+
+    ids = sorted_ids(&habits->file_kinds);
+    n = tally_size(&habits->file_kinds);
+    fprintf(out, "\nBy file:\n");
+    for (i = 0; i < n; i++) {
+        fprintf(out, "  %6lu  %s\n", habits->file_kinds.counts[ids[i]],
+                tally_key(&habits->file_kinds, ids[i]));
+    }
+    free(ids);
+}
+
+static void print_json_mistake(FILE *out, HabitCounts *habits, int id, const char *indent) {
+    char buffer[RECORD_MAX * 2];
+    ErrorRecord record;
+
+    mistake_fields(habits, id, buffer, sizeof(buffer), &record);
+    fprintf(out, "%s{\"count\": %lu, \"code\": \"%s\", \"type\": \"%s\", \"lexeme\": ",
+            indent, habits->index.mistakes.counts[id], error_code_name(record.code),
+            token_type_to_string(record.actual_type));
+    print_json_string(out, record.actual_lexeme);
+    fprintf(out, ", \"line\": %d, \"column\": %d, \"file\": ", record.line, record.column);
+    print_json_string(out, record.file);
+    fprintf(out, ", \"habitual\": %s}",
+            fingerprint_count(habits, &record) >= HABIT_THRESHOLD ? "true" : "false");
+}
+
+static void print_json(FILE *out, HabitCounts *habits, int top_n) {
+    int *ids = sorted_ids(&habits->index.mistakes);
+    int *kind_ids = sorted_ids(&habits->kinds);
+    int *codes = mistake_codes(habits);
+    int n = tally_size(&habits->index.mistakes);
+    int kinds = tally_size(&habits->kinds);
+    int i, k;
+
+    fprintf(out, "{\n  \"errors\": %lu,\n  \"distinct\": %d,\n  \"threshold\": %d,\n",
+            habits->index.events, n, HABIT_THRESHOLD);
+
+    fprintf(out, "  \"top\": [");
+    for (i = 0; i < n && i < top_n; i++) {
+        fprintf(out, "%s\n", i ? "," : "");
+        print_json_mistake(out, habits, ids[i], "    ");
+    }
+    fprintf(out, "%s],\n", n > 0 ? "\n  " : "");
+
+    fprintf(out, "  \"kinds\": [");
+    for (k = 0; k < kinds; k++) {
+        const char *name = tally_key(&habits->kinds, kind_ids[k]);
+        int code = error_code_from_name(name);
+        int rank = 0;
+
+        fprintf(out, "%s\n    {\"code\": \"%s\", \"count\": %lu, \"top\": [", k ? "," : "",
+                name, habits->kinds.counts[kind_ids[k]]);
+        for (i = 0; i < n && rank < top_n; i++) {
+            if (codes[ids[i]] == code) {
+                fprintf(out, "%s\n", rank++ ? "," : "");
+                print_json_mistake(out, habits, ids[i], "      ");
+            }
+        }
+        fprintf(out, "%s]}", rank > 0 ? "\n    " : "");
+    }
+    fprintf(out, "%s],\n", kinds > 0 ? "\n  " : "");
+    free(codes);
+    free(kind_ids);
+    free(ids);
+
+    ids = sorted_ids(&habits->file_kinds);
+    n = tally_size(&habits->file_kinds);
+    fprintf(out, "  \"files\": [");
+    for (i = 0; i < n; i++) {
+        /* File names never contain '|' (error_tracker_set_source) */
+        char file[RECORD_MAX * 2];
+        char *bar;
+
+        snprintf(file, sizeof(file), "%s", tally_key(&habits->file_kinds, ids[i]));
+        bar = strrchr(file, '|');
+        *bar = '\0';
+        fprintf(out, "%s\n    {\"count\": %lu, \"file\": ", i ? "," : "",
+                habits->file_kinds.counts[ids[i]]);
+        print_json_string(out, file);
+        fprintf(out, ", \"code\": \"%s\"}", bar + 1);
+    }
+    fprintf(out, "%s]\n}\n", n > 0 ? "\n  " : "");
+    free(ids);
+}
+
+static void habit_counts_init(HabitCounts *habits) {
+    habit_index_init(&habits->index);
+    tally_init(&habits->fingerprints);
+    tally_init(&habits->kinds);
+    tally_init(&habits->file_kinds);
+}
+
+static void habit_counts_free(HabitCounts *habits) {
+    habit_index_free(&habits->index);
+    tally_free(&habits->fingerprints);
+    tally_free(&habits->kinds);
+    tally_free(&habits->file_kinds);
+}
+
+int habits_report(FILE *out, int top_n, HabitsFormat format) {
+    HabitCounts habits;
+    FILE *log;
+    long log_size;
+
+    profile_store_flush();
+    log = fopen(profile_path(PROFILE_LOG), "rb");
+    if (log == NULL) {
+        return 1;
+    }
+    fseek(log, 0, SEEK_END);
+    log_size = ftell(log);
+
+    /* Without a usable index, start over from the beginning of the log */
+    habit_counts_init(&habits);
+    habit_index_load(&habits.index, profile_path(PROFILE_INDEX), log_size, count_record, &habits);
+
+    if (habits.index.log_offset < log_size) {
+        habit_index_read_log(&habits.index, log, count_record, &habits);
+        habit_index_save(&habits.index, profile_path(PROFILE_INDEX));
+    }
+    fclose(log);
+
+    if (format == HABITS_JSON) {
+        print_json(out, &habits, top_n);
+    } else {
+        print_text(out, &habits, top_n);
+    }
+
+    habit_counts_free(&habits);
+    return 0;
+}
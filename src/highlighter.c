@@ -1,26 +1,10 @@
 // Code highlighting
 
 #include <stdio.h>
-#include <string.h>
 #include "lexer.h"
 #include "highlighter.h"
 
-static const char* token_type_to_string(TokenType type) {
-    switch (type) {
-        case TOKEN_KEYWORD:    return "TOKEN_KEYWORD";
-        case TOKEN_IDENTIFIER: return "TOKEN_IDENTIFIER";
-        case TOKEN_NUMBER:     return "TOKEN_NUMBER";
-        case TOKEN_SYMBOL:     return "TOKEN_SYMBOL";
-        case TOKEN_EOF:        return "TOKEN_EOF";
-        case TOKEN_UNKNOWN:    return "TOKEN_UNKNOWN";
-        default:               return "UNKNOWN";
-    }
-}
-
-void highlight_error(const char *error_type,
-                     const char *expected_type,
-                     const char *expected_lexeme,
-                     const Token *actual_token) {
+void highlight_error(ErrorCode code, const Token *actual_token) {
     printf("\n");
     printf("Line %d, Column %d:\n", actual_token->line, actual_token->column);
     
@@ -31,25 +15,39 @@ void highlight_error(const char *error_type,
     }
     printf("^\n");
     
-    /* Print explanation based on error type */
-    if (expected_type != NULL && strcmp(expected_type, "TOKEN_SYMBOL") == 0 &&
-        expected_lexeme != NULL && strcmp(expected_lexeme, ";") == 0) {
-        /* Missing semicolon error */
-        printf("Missing semicolon at end of statement.\n");
-        printf("Statements must end with ';'.\n");
-        printf("Example: <statement>;\n");
-    } else {
-        /* Generic syntax error explanation */
-        printf("What went wrong: ");
-        if (expected_type != NULL && expected_lexeme != NULL) {
-            printf("Expected %s \"%s\"", expected_type, expected_lexeme);
-        }
-        if (actual_token != NULL) {
-            printf(", but found %s \"%s\"", 
+    /* Print explanation based on error code */
+    switch (code) {
+        case E_MISSING_SEMICOLON:
+            printf("Missing semicolon at end of statement.\n");
+            printf("Statements must end with ';'.\n");
+            printf("Example: <statement>;\n");
+            break;
+        case E_MISSING_BRACE:
+            /* The caret marks the unmatched '{' */
+            printf("Missing closing brace for the '{' marked above.\n");
+            printf("Every block opened with '{' must be closed with '}'.\n");
+            printf("Example: while (x) { <statements> }\n");
+            break;
+        case E_UNDECLARED_VARIABLE:
+            printf("Variable '%s' is used before it is declared.\n", actual_token->lexeme);
+            printf("Declare it first: int %s;\n", actual_token->lexeme);
+            break;
+        case E_REDECLARED_VARIABLE:
+            printf("Variable '%s' is already declared in this scope.\n", actual_token->lexeme);
+            printf("Remove the extra declaration or choose a different name.\n");
+            break;
+        case E_REDEFINED_FUNCTION:
+            printf("Function '%s' is already defined.\n", actual_token->lexeme);
+            printf("Each function needs a unique name.\n");
+            break;
+        default:
+            /* Generic syntax error explanation */
+            printf("What went wrong: Expected %s \"%s\", but found %s \"%s\".\n",
+                   error_expected_type(code),
+                   error_expected_lexeme(code),
                    token_type_to_string(actual_token->type),
                    actual_token->lexeme);
-        }
-        printf(".\n");
+            break;
     }
     
     printf("\n");
@@ -4,10 +4,80 @@
 #include <string.h>
 #include "lexer.h"
 
+/*
+ * Input is pulled through a fixed-size ring buffer refilled with fread
+ * (or copied from an in-memory buffer), so reading it takes constant
+ * memory and pipes work as well as regular files. One already-consumed
+ * byte is always kept in the ring so the lexer can push back a single
+ * character of lookahead, even across a refill boundary.
+ *
+ * The ring bounds only the input. For stdin (hasc - without --run) the
+ * parser and the semantic pass also work a piece at a time (see
+ * parser_set_sink()), so that compile grows only by one interned name per
+ * function. lex_all() stores every token for the repair trials and the
+ * parallel parser; packed tokens with interned lexemes hold that to 16
+ * bytes per token plus each distinct spelling once.
+ */
+#ifndef LEXER_RING_SIZE
+#define LEXER_RING_SIZE 65536 /* power of two */
+#endif
+#define LEXER_RING_MASK (LEXER_RING_SIZE - 1)
+
 static FILE *source_file = NULL;
+static int owns_source_file = 0;
+static const char *source_buffer = NULL;   /* in-memory input, if any */
+static size_t source_buffer_size = 0;
+static size_t source_buffer_pos = 0;
+static unsigned char ring[LEXER_RING_SIZE];
+static size_t ring_head = 0;   /* next byte to hand out (monotonic) */
+static size_t ring_tail = 0;   /* one past the last byte read (monotonic) */
+static int source_eof = 0;
 static int current_line = 1;
 static int current_column = 0;
 
+static int refill_ring(void) {
+    /* Leave room for the pushback byte just behind ring_head */
+    size_t free_space = LEXER_RING_SIZE - (ring_tail - ring_head) - 1;
+    size_t offset = ring_tail & LEXER_RING_MASK;
+    size_t chunk = LEXER_RING_SIZE - offset;
+    size_t got;
+
+    if (source_eof || free_space == 0) {
+        return 0;
+    }
+    if (chunk > free_space) {
+        chunk = free_space;
+    }
+
+    if (source_buffer != NULL) {
+        got = source_buffer_size - source_buffer_pos;
+        if (got > chunk) {
+            got = chunk;
+        }
+        memcpy(ring + offset, source_buffer + source_buffer_pos, got);
+        source_buffer_pos += got;
+    } else {
+        got = fread(ring + offset, 1, chunk, source_file);
+    }
+    if (got == 0) {
+        source_eof = 1;
+        return 0;
+    }
+    ring_tail += got;
+    return 1;
+}
+
+static int next_char(void) {
+    if (ring_head == ring_tail && !refill_ring()) {
+        return EOF;
+    }
+    return ring[ring_head++ & LEXER_RING_MASK];
+}
+
+static void unread_char(void) {
+    ring_head--;
+}
+
 static int is_keyword(const char *lexeme) {
     return (strcmp(lexeme, "int") == 0 ||
             strcmp(lexeme, "if") == 0 ||
@@ -23,14 +93,49 @@ static int is_single_symbol(int c) {
             c == '<' || c == '>');
 }
 
+const char* token_type_to_string(TokenType type) {
+    switch (type) {
+        case TOKEN_KEYWORD:    return "TOKEN_KEYWORD";
+        case TOKEN_IDENTIFIER: return "TOKEN_IDENTIFIER";
+        case TOKEN_NUMBER:     return "TOKEN_NUMBER";
+        case TOKEN_SYMBOL:     return "TOKEN_SYMBOL";
+        case TOKEN_EOF:        return "TOKEN_EOF";
+        case TOKEN_UNKNOWN:    return "TOKEN_UNKNOWN";
+        default:               return "UNKNOWN";
+    }
+}
+
+void init_lexer_stream(FILE *stream) {
+    source_file = stream;
+    owns_source_file = 0;
+    source_buffer = NULL;
+    ring_head = 0;
+    ring_tail = 0;
+    source_eof = 0;
+    current_line = 1;
+    current_column = 0;
+}
+
 void init_lexer(const char *filename) {
-    source_file = fopen(filename, "r");
-    if (source_file == NULL) {
+    if (strcmp(filename, "-") == 0) {
+        init_lexer_stream(stdin);
+        return;
+    }
+
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
         fprintf(stderr, "Error: Cannot open file '%s'\n", filename);
         exit(1);
     }
-    current_line = 1;
-    current_column = 0;
+    init_lexer_stream(file);
+    owns_source_file = 1;
+}
+
+void init_lexer_buffer(const char *data, size_t size) {
+    init_lexer_stream(NULL);
+    source_buffer = data;
+    source_buffer_size = size;
+    source_buffer_pos = 0;
 }
 
 Token get_next_token(void) {
@@ -38,7 +143,7 @@ Token get_next_token(void) {
     int c;
     
     // Skip whitespace
-    while ((c = fgetc(source_file)) != EOF) {
+    while ((c = next_char()) != EOF) {
         current_column++;
         
         if (c == '\n') {
@@ -58,7 +163,7 @@ Token get_next_token(void) {
                 token.lexeme[len++] = (char)c;
                 
                 // Read remaining alphanumeric characters
-                while ((c = fgetc(source_file)) != EOF && isalnum((unsigned char)c)) {
+                while ((c = next_char()) != EOF && isalnum((unsigned char)c)) {
                     current_column++;
                     if (len < 63) { // Leave room for null terminator
                         token.lexeme[len++] = (char)c;
@@ -67,7 +172,7 @@ Token get_next_token(void) {
                 
                 // Push back the non-alphanumeric character
                 if (c != EOF) {
-                    ungetc(c, source_file);
+                    unread_char();
                     current_column--;
                 }
                 
@@ -93,7 +198,7 @@ Token get_next_token(void) {
                 token.lexeme[len++] = (char)c;
                 
                 // Read remaining digits
-                while ((c = fgetc(source_file)) != EOF && isdigit((unsigned char)c)) {
+                while ((c = next_char()) != EOF && isdigit((unsigned char)c)) {
                     current_column++;
                     if (len < 63) { // Leave room for null terminator
                         token.lexeme[len++] = (char)c;
@@ -102,7 +207,7 @@ Token get_next_token(void) {
                 
                 // Push back the non-digit character
                 if (c != EOF) {
-                    ungetc(c, source_file);
+                    unread_char();
                     current_column--;
                 }
                 
@@ -119,7 +224,7 @@ Token get_next_token(void) {
 
                 // Multi-character operators first: == != <= >=
                 if (c == '=' || c == '!' || c == '<' || c == '>') {
-                    int next = fgetc(source_file);
+                    int next = next_char();
                     if (next != EOF) {
                         current_column++;
                     }
@@ -138,7 +243,7 @@ Token get_next_token(void) {
                     }
 
                     if (next != EOF) {
-                        ungetc(next, source_file);
+                        unread_char();
                         current_column--;
                     }
                 }
@@ -173,8 +278,69 @@ Token get_next_token(void) {
 }
 
 void close_lexer(void) {
-    if (source_file != NULL) {
+    if (source_file != NULL && owns_source_file) {
         fclose(source_file);
-        source_file = NULL;
     }
+    source_file = NULL;
+    owns_source_file = 0;
+    source_buffer = NULL;
+}
+
+void token_array_init(TokenArray *array) {
+    array->tokens = NULL;
+    array->count = 0;
+    array->capacity = 0;
+    symbol_table_init(&array->lexemes);
+}
+
+void token_array_free(TokenArray *array) {
+    free(array->tokens);
+    symbol_table_free(&array->lexemes);
+    array->tokens = NULL;
+    array->count = 0;
+    array->capacity = 0;
+}
+
+void token_array_push(TokenArray *array, const Token *token) {
+    PackedToken *packed;
+
+    if (array->count == array->capacity) {
+        int new_capacity = array->capacity ? array->capacity * 2 : 1024;
+        PackedToken *grown = realloc(array->tokens, (size_t)new_capacity * sizeof(PackedToken));
+        if (grown == NULL) {
+            fprintf(stderr, "Error: Out of memory while lexing\n");
+            exit(1);
+        }
+        array->tokens = grown;
+        array->capacity = new_capacity;
+    }
+    packed = &array->tokens[array->count++];
+    packed->type = (unsigned char)token->type;
+    packed->lexeme = symbol_intern(&array->lexemes, token->lexeme);
+    packed->line = token->line;
+    packed->column = token->column;
+}
+
+Token token_array_at(const TokenArray *array, int index) {
+    const PackedToken *packed = &array->tokens[index];
+    Token token;
+
+    token.type = (TokenType)packed->type;
+    strcpy(token.lexeme, symbol_spelling(&array->lexemes, packed->lexeme));
+    token.line = packed->line;
+    token.column = packed->column;
+    return token;
+}
+
+const char *token_array_lexeme(const TokenArray *array, int index) {
+    return symbol_spelling(&array->lexemes, array->tokens[index].lexeme);
+}
+
+void lex_all(TokenArray *array) {
+    Token token;
+
+    do {
+        token = get_next_token();
+        token_array_push(array, &token);
+    } while (token.type != TOKEN_EOF);
 }
@@ -0,0 +1,657 @@
+// Batch file loading with read-ahead
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "config.h"
+#include "loader.h"
+
+#if defined(HASC_IO_URING) && defined(__linux__)
+#define LOADER_HAVE_URING 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <linux/stat.h>
+#endif
+
+typedef enum {
+    SLOT_EMPTY,
+    SLOT_STATING,         /* io_uring: statx in flight */
+    SLOT_SIZED,           /* io_uring: sized, waiting for budget (not open) */
+    SLOT_OPENING,         /* io_uring: admitted, openat in flight */
+    SLOT_READING,         /* io_uring: read in flight */
+    SLOT_READY
+} SlotState;
+
+typedef struct {
+    int state;            /* SlotState */
+    char *data;
+    size_t size;
+    size_t done;          /* io_uring: bytes read so far */
+    int fd;
+#ifdef LOADER_HAVE_URING
+    struct statx stx;     /* io_uring: filled in by statx */
+#endif
+} LoadSlot;
+
+#ifdef LOADER_HAVE_URING
+/* Minimal io_uring driver on raw syscalls, so no liburing is needed */
+typedef struct {
+    int fd;
+    unsigned entries;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring;
+    void *cq_ring;
+    size_t sq_ring_size;
+    size_t cq_ring_size;
+    unsigned pending;     /* queued SQEs not yet submitted */
+} Uring;
+#endif
+
+struct Loader {
+    const char *const *paths;
+    int count;
+    int depth;
+    size_t budget;
+    size_t inflight;
+    int next_issue;       /* next file a read is started for */
+    int next_consume;     /* next file handed out */
+    LoadSlot *slots;      /* file i lives in slots[i % depth] */
+    LoaderBackend backend;
+    double wait_ms;
+
+    pthread_mutex_t lock;
+    pthread_cond_t ready;       /* a slot became READY (consumer waits) */
+    pthread_cond_t space;       /* window or budget freed (workers wait) */
+    pthread_t *threads;
+    int thread_count;
+    int stopping;
+    int budget_waiters;
+
+#ifdef LOADER_HAVE_URING
+    Uring ring;
+    int open_files;       /* descriptors opened and not yet closed */
+    int max_open;
+#endif
+};
+
+static double loader_now_ms(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+/* Open a file and find its size; NULL if it cannot be opened */
+static FILE *open_sized(const char *path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    long end;
+
+    if (file == NULL) {
+        return NULL;
+    }
+    if (fseek(file, 0, SEEK_END) != 0 || (end = ftell(file)) < 0 ||
+        fseek(file, 0, SEEK_SET) != 0) {
+        fclose(file);
+        return NULL;
+    }
+    *size = (size_t)end;
+    return file;
+}
+
+static char *read_open(FILE *file, size_t *size) {
+    char *data = malloc(*size > 0 ? *size : 1);
+
+    if (data == NULL) {
+        fprintf(stderr, "Error: Out of memory while loading files\n");
+        exit(1);
+    }
+    *size = fread(data, 1, *size, file);
+    return data;
+}
+
+/* ---- Thread backend ---- */
+
+static void *loader_worker(void *arg) {
+    Loader *loader = arg;
+
+    pthread_mutex_lock(&loader->lock);
+    for (;;) {
+        FILE *file;
+        LoadSlot *slot;
+        char *data = NULL;
+        size_t size = 0;
+        size_t reserved;
+        int index;
+
+        while (!loader->stopping && loader->next_issue < loader->count &&
+               loader->next_issue >= loader->next_consume + loader->depth) {
+            pthread_cond_wait(&loader->space, &loader->lock);
+        }
+        if (loader->stopping || loader->next_issue >= loader->count) {
+            break;
+        }
+        index = loader->next_issue++;
+        pthread_mutex_unlock(&loader->lock);
+
+        file = open_sized(loader->paths[index], &size);
+        reserved = size;
+
+        pthread_mutex_lock(&loader->lock);
+        while (file != NULL && !loader->stopping && index != loader->next_consume &&
+               loader->inflight > 0 && loader->inflight + size > loader->budget) {
+            loader->budget_waiters++;
+            pthread_cond_wait(&loader->space, &loader->lock);
+            loader->budget_waiters--;
+        }
+        if (file != NULL) {
+            loader->inflight += reserved;
+        }
+        pthread_mutex_unlock(&loader->lock);
+
+        if (file != NULL) {
+            data = read_open(file, &size);
+            fclose(file);
+        }
+
+        pthread_mutex_lock(&loader->lock);
+        loader->inflight -= reserved - (data != NULL ? size : 0);
+        slot = &loader->slots[index % loader->depth];
+        slot->data = data;
+        slot->size = data != NULL ? size : 0;
+        slot->state = SLOT_READY;
+        if (index == loader->next_consume) {
+            pthread_cond_signal(&loader->ready);
+        }
+        if (reserved != (data != NULL ? size : 0)) {
+            pthread_cond_broadcast(&loader->space); /* budget came back */
+        }
+    }
+    pthread_mutex_unlock(&loader->lock);
+    return NULL;
+}
+
+static int start_threads(Loader *loader) {
+    int wanted = LOADER_IO_THREADS < loader->depth ? LOADER_IO_THREADS : loader->depth;
+    int i;
+
+    loader->threads = malloc((size_t)wanted * sizeof(pthread_t));
+    if (loader->threads == NULL) {
+        return 0;
+    }
+    for (i = 0; i < wanted; i++) {
+        if (pthread_create(&loader->threads[loader->thread_count], NULL,
+                           loader_worker, loader) == 0) {
+            loader->thread_count++;
+        }
+    }
+    return loader->thread_count > 0;
+}
+
+/* ---- io_uring backend ---- */
+
+#ifdef LOADER_HAVE_URING
+
+#define OP_OPEN 0
+#define OP_READ 1
+#define OP_STAT 2
+
+/* io_uring_setup works from Linux 5.1, but OPENAT, STATX and READ (and the
+ * probe itself) only arrived in 5.6; without them every open would fail */
+static int uring_supported(int fd) {
+    size_t size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, size);
+    int ok;
+
+    if (probe == NULL) {
+        return 0;
+    }
+    ok = syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) == 0 &&
+         probe->last_op >= IORING_OP_OPENAT && probe->last_op >= IORING_OP_STATX &&
+         probe->last_op >= IORING_OP_READ &&
+         (probe->ops[IORING_OP_OPENAT].flags & IO_URING_OP_SUPPORTED) &&
+         (probe->ops[IORING_OP_STATX].flags & IO_URING_OP_SUPPORTED) &&
+         (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED);
+    free(probe);
+    return ok;
+}
+
+static int uring_init(Uring *ring, unsigned entries) {
+    struct io_uring_params params;
+    unsigned char *sq;
+    unsigned char *cq;
+
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        return 0;
+    }
+    if (!uring_supported(ring->fd)) {
+        close(ring->fd);
+        return 0; /* the thread backend takes over */
+    }
+    ring->entries = params.sq_entries;
+    ring->pending = 0;
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size) {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        close(ring->fd);
+        return 0;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) {
+            munmap(ring->sq_ring, ring->sq_ring_size);
+            close(ring->fd);
+            return 0;
+        }
+    }
+    ring->sqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe),
+                      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        if (ring->cq_ring != ring->sq_ring) {
+            munmap(ring->cq_ring, ring->cq_ring_size);
+        }
+        munmap(ring->sq_ring, ring->sq_ring_size);
+        close(ring->fd);
+        return 0;
+    }
+
+    sq = ring->sq_ring;
+    cq = ring->cq_ring;
+    ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return 1;
+}
+
+static void uring_free(Uring *ring) {
+    munmap(ring->sqes, ring->entries * sizeof(struct io_uring_sqe));
+    if (ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+}
+
+/* Every slot has at most one request in flight and the ring has at least
+ * `depth` entries, so an SQE is always available here. */
+static struct io_uring_sqe *uring_sqe(Uring *ring, int index, int op) {
+    unsigned tail = *ring->sq_tail;
+    unsigned slot = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[slot];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = ((unsigned long long)index << 2) | (unsigned)op;
+    ring->sq_array[slot] = slot;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->pending++;
+    return sqe;
+}
+
+static void uring_enter(Uring *ring, unsigned wait_for) {
+    unsigned to_submit = ring->pending;
+
+    ring->pending = 0;
+    if (to_submit == 0 && wait_for == 0) {
+        return;
+    }
+    syscall(__NR_io_uring_enter, ring->fd, to_submit, wait_for,
+            wait_for ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+}
+
+static void uring_queue_read(Loader *loader, int index) {
+    LoadSlot *slot = &loader->slots[index % loader->depth];
+    struct io_uring_sqe *sqe = uring_sqe(&loader->ring, index, OP_READ);
+
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = slot->fd;
+    sqe->addr = (unsigned long long)(slot->data + slot->done);
+    sqe->len = (unsigned)(slot->size - slot->done);
+    sqe->off = slot->done;
+    slot->state = SLOT_READING;
+}
+
+static void uring_finish(Loader *loader, LoadSlot *slot, int ok) {
+    if (slot->fd >= 0) {
+        close(slot->fd);
+        slot->fd = -1;
+        loader->open_files--;
+    }
+    if (!ok) {
+        loader->inflight -= slot->size;
+        free(slot->data);
+        slot->data = NULL;
+        slot->size = 0;
+    } else if (slot->done < slot->size) {
+        /* The file shrank under us */
+        loader->inflight -= slot->size - slot->done;
+        slot->size = slot->done;
+    }
+    slot->state = SLOT_READY;
+}
+
+/*
+ * Start size lookups for files entering the window, then opens and reads
+ * for sized files that fit in the budget, oldest first. statx needs no
+ * descriptor, so only admitted files are open, and at most max_open of
+ * them (plus the one the consumer waits for) at a time.
+ */
+static void uring_pump(Loader *loader) {
+    int index;
+
+    while (loader->next_issue < loader->count &&
+           loader->next_issue < loader->next_consume + loader->depth) {
+        LoadSlot *slot = &loader->slots[loader->next_issue % loader->depth];
+        struct io_uring_sqe *sqe = uring_sqe(&loader->ring, loader->next_issue, OP_STAT);
+
+        sqe->opcode = IORING_OP_STATX;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (unsigned long long)loader->paths[loader->next_issue];
+        sqe->len = STATX_SIZE;
+        sqe->off = (unsigned long long)&slot->stx;
+        slot->state = SLOT_STATING;
+        slot->fd = -1;
+        loader->next_issue++;
+    }
+
+    for (index = loader->next_consume; index < loader->next_issue; index++) {
+        LoadSlot *slot = &loader->slots[index % loader->depth];
+        struct io_uring_sqe *sqe;
+
+        if (slot->state != SLOT_SIZED) {
+            continue;
+        }
+        if (index != loader->next_consume &&
+            ((loader->inflight > 0 && loader->inflight + slot->size > loader->budget) ||
+             loader->open_files >= loader->max_open)) {
+            break;
+        }
+        slot->data = malloc(slot->size > 0 ? slot->size : 1);
+        if (slot->data == NULL) {
+            fprintf(stderr, "Error: Out of memory while loading files\n");
+            exit(1);
+        }
+        loader->inflight += slot->size;
+        slot->done = 0;
+
+        sqe = uring_sqe(&loader->ring, index, OP_OPEN);
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (unsigned long long)loader->paths[index];
+        sqe->open_flags = O_RDONLY;
+        slot->state = SLOT_OPENING;
+        loader->open_files++;
+    }
+
+    uring_enter(&loader->ring, 0);
+}
+
+static void uring_reap(Loader *loader) {
+    Uring *ring = &loader->ring;
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; head++) {
+        const struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+        int index = (int)(cqe->user_data >> 2);
+        int op = (int)(cqe->user_data & 3);
+        LoadSlot *slot = &loader->slots[index % loader->depth];
+
+        if (op == OP_STAT) {
+            if (cqe->res < 0) {
+                slot->data = NULL;
+                slot->size = 0;
+                slot->state = SLOT_READY;
+                continue;
+            }
+            slot->size = (size_t)slot->stx.stx_size;
+            slot->state = SLOT_SIZED;
+        } else if (op == OP_OPEN) {
+            if (cqe->res < 0) {
+                loader->open_files--;
+                uring_finish(loader, slot, 0);
+                continue;
+            }
+            slot->fd = cqe->res;
+            if (slot->size == 0) {
+                uring_finish(loader, slot, 1);
+            } else {
+                uring_queue_read(loader, index);
+            }
+        } else if (cqe->res < 0) {
+            uring_finish(loader, slot, 0);
+        } else {
+            slot->done += (size_t)cqe->res;
+            if (cqe->res == 0 || slot->done >= slot->size) {
+                uring_finish(loader, slot, 1);
+            } else {
+                uring_queue_read(loader, index); /* short read: fetch the rest */
+            }
+        }
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+}
+
+#endif /* LOADER_HAVE_URING */
+
+/* ---- Public interface ---- */
+
+Loader *loader_open(const char *const *paths, int count, int depth, size_t budget) {
+    Loader *loader = calloc(1, sizeof(Loader));
+
+    if (loader == NULL) {
+        fprintf(stderr, "Error: Out of memory while loading files\n");
+        exit(1);
+    }
+    if (depth > LOADER_MAX_PREFETCH) {
+        depth = LOADER_MAX_PREFETCH;
+    }
+    loader->paths = paths;
+    loader->count = count;
+    loader->depth = depth < 0 ? 0 : depth;
+    loader->budget = budget;
+    loader->backend = LOADER_SYNC;
+    pthread_mutex_init(&loader->lock, NULL);
+    pthread_cond_init(&loader->ready, NULL);
+    pthread_cond_init(&loader->space, NULL);
+
+    if (loader->depth == 0) {
+        return loader;
+    }
+    loader->slots = calloc((size_t)loader->depth, sizeof(LoadSlot));
+    if (loader->slots == NULL) {
+        fprintf(stderr, "Error: Out of memory while loading files\n");
+        exit(1);
+    }
+
+#ifdef LOADER_HAVE_URING
+    {
+        unsigned entries = 4;
+        struct rlimit limit;
+
+        while (entries < (unsigned)loader->depth) {
+            entries *= 2;
+        }
+        /* Leave most descriptors to the rest of the compiler (profile logs) */
+        loader->max_open = loader->depth;
+        if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY &&
+            limit.rlim_cur / LOADER_FD_SHARE < (rlim_t)loader->max_open) {
+            loader->max_open = limit.rlim_cur / LOADER_FD_SHARE > 0
+                                   ? (int)(limit.rlim_cur / LOADER_FD_SHARE) : 1;
+        }
+        if (uring_init(&loader->ring, entries)) {
+            loader->backend = LOADER_IO_URING;
+            return loader;
+        }
+    }
+#endif
+
+    if (start_threads(loader)) {
+        loader->backend = LOADER_THREADS;
+    } else {
+        loader->depth = 0; /* no threads: read synchronously */
+    }
+    return loader;
+}
+
+int loader_next(Loader *loader, LoadedFile *file) {
+    int index = loader->next_consume;
+    double start;
+
+    if (index >= loader->count) {
+        return 0;
+    }
+    file->index = index;
+    file->path = loader->paths[index];
+
+    start = loader_now_ms();
+    if (loader->backend == LOADER_SYNC) {
+        FILE *source = open_sized(file->path, &file->size);
+
+        file->data = NULL;
+        if (source != NULL) {
+            file->data = read_open(source, &file->size);
+            fclose(source);
+        } else {
+            file->size = 0;
+        }
+    } else {
+        LoadSlot *slot = &loader->slots[index % loader->depth];
+
+        if (loader->backend == LOADER_THREADS) {
+            pthread_mutex_lock(&loader->lock);
+            while (slot->state != SLOT_READY) {
+                pthread_cond_wait(&loader->ready, &loader->lock);
+            }
+            pthread_mutex_unlock(&loader->lock);
+        }
+#ifdef LOADER_HAVE_URING
+        else {
+            for (;;) {
+                uring_pump(loader);
+                if (slot->state == SLOT_READY) {
+                    break;
+                }
+                uring_enter(&loader->ring, 1);
+                uring_reap(loader);
+            }
+        }
+#endif
+        file->data = slot->data;
+        file->size = slot->size;
+        slot->data = NULL;
+        slot->state = SLOT_EMPTY;
+    }
+    loader->wait_ms += loader_now_ms() - start;
+    return 1;
+}
+
+void loader_release(Loader *loader, LoadedFile *file) {
+    free(file->data);
+    file->data = NULL;
+
+    if (loader->backend == LOADER_THREADS) {
+        pthread_mutex_lock(&loader->lock);
+    }
+    if (loader->backend != LOADER_SYNC) {
+        loader->inflight -= file->size;
+    }
+    loader->next_consume = file->index + 1;
+    if (loader->backend == LOADER_THREADS) {
+        /* One window slot opened up; only budget waiters need everyone woken */
+        if (loader->budget_waiters > 0) {
+            pthread_cond_broadcast(&loader->space);
+        } else {
+            pthread_cond_signal(&loader->space);
+        }
+        pthread_mutex_unlock(&loader->lock);
+    }
+#ifdef LOADER_HAVE_URING
+    if (loader->backend == LOADER_IO_URING) {
+        uring_pump(loader); /* refill the window before the caller starts lexing */
+    }
+#endif
+}
+
+void loader_close(Loader *loader) {
+    int i;
+
+    if (loader->backend == LOADER_THREADS) {
+        pthread_mutex_lock(&loader->lock);
+        loader->stopping = 1;
+        pthread_cond_broadcast(&loader->space);
+        pthread_mutex_unlock(&loader->lock);
+        for (i = 0; i < loader->thread_count; i++) {
+            pthread_join(loader->threads[i], NULL);
+        }
+    }
+#ifdef LOADER_HAVE_URING
+    if (loader->backend == LOADER_IO_URING) {
+        /* Let requests still in flight land before their buffers go away */
+        for (i = loader->next_consume; i < loader->next_issue; i++) {
+            LoadSlot *slot = &loader->slots[i % loader->depth];
+            while (slot->state == SLOT_STATING || slot->state == SLOT_OPENING ||
+                   slot->state == SLOT_READING) {
+                uring_enter(&loader->ring, 1);
+                uring_reap(loader);
+            }
+        }
+        uring_free(&loader->ring);
+    }
+#endif
+
+    for (i = 0; i < loader->depth; i++) {
+        free(loader->slots[i].data);
+    }
+    free(loader->slots);
+    free(loader->threads);
+    pthread_mutex_destroy(&loader->lock);
+    pthread_cond_destroy(&loader->ready);
+    pthread_cond_destroy(&loader->space);
+    free(loader);
+}
+
+LoaderBackend loader_backend(const Loader *loader) {
+    return loader->backend;
+}
+
+const char *loader_backend_name(LoaderBackend backend) {
+    switch (backend) {
+        case LOADER_THREADS:  return "threads";
+        case LOADER_IO_URING: return "io_uring";
+        default:              return "sync";
+    }
+}
+
+double loader_wait_ms(const Loader *loader) {
+    return loader->wait_ms;
+}
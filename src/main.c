@@ -1,37 +1,387 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <limits.h>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
 #include "lexer.h"
+#include "ast.h"
 #include "parser.h"
+#include "symbol_table.h"
+#include "semantic.h"
+#include "habits.h"
+#include "error_tracker.h"
+#include "config.h"
 #include "autofix.h"
+#include "token_file.h"
+#include "loader.h"
+#include "habit_sketch.h"
+#include "profile_store.h"
+#include "executor.h"
 
-const char* token_type_to_string(TokenType type) {
-    switch (type) {
-        case TOKEN_KEYWORD:   return "TOKEN_KEYWORD";
-        case TOKEN_IDENTIFIER: return "TOKEN_IDENTIFIER";
-        case TOKEN_NUMBER:    return "TOKEN_NUMBER";
-        case TOKEN_SYMBOL:    return "TOKEN_SYMBOL";
-        case TOKEN_EOF:       return "TOKEN_EOF";
-        case TOKEN_UNKNOWN:   return "TOKEN_UNKNOWN";
-        default:              return "UNKNOWN";
+static void print_usage(FILE *stream) {
+    fprintf(stream, "Usage: hasc [--max-autofix N] [--threads N] [--time] [--sketch[=BYTES]]\n"
+                    "            [--user ID] [--emit-tokens FILE] [--run [--tier-up N]\n"
+                    "            [--max-steps N] | --bench] <source_file>\n"
+                    "       hasc [options] --load-tokens FILE | --batch LIST [--prefetch N]\n"
+                    "       hasc --habits | --sketch-audit | --reset [--user ID] | --help\n");
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+/* Peak resident memory in KiB, or -1 where it cannot be read */
+static long peak_memory_kib(void) {
+#ifdef _WIN32
+    return -1;
+#else
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+#ifdef __APPLE__
+    return (long)(usage.ru_maxrss / 1024); /* bytes there */
+#else
+    return (long)usage.ru_maxrss;
+#endif
+#endif
+}
+
+/* Streamed stdin: what has been checked and dropped so far */
+typedef struct {
+    int in_function;      /* semantic_begin_function() called, not ended */
+    int functions;
+    long long stmts;
+    long long exprs;
+    double semantic_ms;
+} StreamCheck;
+
+/* Parser sink for streamed stdin: check each piece as soon as it is
+ * parsed, then drop it so the Ast holds one piece of one function */
+static void check_streamed(Ast *ast, int function, int done, void *arg) {
+    StreamCheck *check = arg;
+    const FunctionNode *node = &ast->functions[function];
+    double start = now_ms();
+
+    if (!check->in_function) {
+        semantic_begin_function(ast, function);
+        check->in_function = 1;
+    }
+    semantic_check_statements(ast, node->body_start, done ? node->body_end : ast->stmt_count);
+    check->stmts += ast->stmt_count;
+    check->exprs += ast->expr_count;
+
+    if (done) {
+        semantic_end_function(1);
+        check->in_function = 0;
+        check->functions++;
+        ast_clear(ast);
+    } else {
+        ast_drop_body(ast);
+    }
+    check->semantic_ms += now_ms() - start;
+}
+
+/* Match --user ID / --user=ID at argv[*i], stepping past its value */
+static int match_user_option(int argc, char *argv[], int *i, const char **user) {
+    if (strcmp(argv[*i], "--user") == 0 && *i + 1 < argc) {
+        *user = argv[++*i];
+        return 1;
     }
+    if (strncmp(argv[*i], "--user=", 7) == 0) {
+        *user = argv[*i] + 7;
+        return 1;
+    }
+    return 0;
+}
+
+/* Parse the value of option `name` as an integer in [min, max]. A
+ * missing or malformed value is a usage error. */
+static long long parse_number(const char *name, const char *text, long long min, long long max) {
+    char *end;
+    long long value;
+
+    if (text == NULL || *text == '\0') {
+        fprintf(stderr, "Error: Option '%s' needs a value\n", name);
+        print_usage(stderr);
+        exit(1);
+    }
+    errno = 0;
+    value = strtoll(text, &end, 10);
+    if (*end != '\0' || errno == ERANGE || value < min || value > max) {
+        fprintf(stderr, "Error: Invalid value '%s' for %s (expected %lld to %lld)\n",
+                text, name, min, max);
+        print_usage(stderr);
+        exit(1);
+    }
+    return value;
+}
+
+/* Match NAME N / NAME=N at argv[*i], stepping past its value */
+static int match_number_option(int argc, char *argv[], int *i, const char *name,
+                               long long min, long long max, long long *value) {
+    size_t len = strlen(name);
+
+    if (strcmp(argv[*i], name) == 0) {
+        *value = parse_number(name, *i + 1 < argc ? argv[++*i] : NULL, min, max);
+        return 1;
+    }
+    if (strncmp(argv[*i], name, len) == 0 && argv[*i][len] == '=') {
+        *value = parse_number(name, argv[*i] + len + 1, min, max);
+        return 1;
+    }
+    return 0;
+}
+
+static int select_user(const char *user) {
+    if (profile_select(user) != 0) {
+        fprintf(stderr, "Error: User id longer than %d characters\n", PROFILE_ID_MAX);
+        return 1;
+    }
+    return 0;
+}
+
+/* Read a --batch list: one path per line, optionally followed by a tab and
+ * the user id to charge its errors to; blank lines ignored. `users[i]` is
+ * NULL for lines without one. Returns 0 on success. */
+static int read_path_list(const char *list_path, char ***out, char ***out_users, int *count) {
+    FILE *list = strcmp(list_path, "-") == 0 ? stdin : fopen(list_path, "r");
+    char **paths = NULL;
+    char **users = NULL;
+    int capacity = 0;
+    char line[4096];
+
+    *count = 0;
+    if (list == NULL) {
+        return 1;
+    }
+    while (fgets(line, sizeof(line), list) != NULL) {
+        size_t len = strcspn(line, "\r\n");
+
+        line[len] = '\0';
+        if (len == 0) {
+            continue;
+        }
+        if (*count == capacity) {
+            char **grown;
+            capacity = capacity ? capacity * 2 : 64;
+            grown = realloc(paths, (size_t)capacity * sizeof(char *));
+            if (grown != NULL) {
+                paths = grown;
+                grown = realloc(users, (size_t)capacity * sizeof(char *));
+            }
+            if (grown == NULL) {
+                fprintf(stderr, "Error: Out of memory while reading batch list\n");
+                exit(1);
+            }
+            users = grown;
+        }
+        paths[*count] = malloc(len + 1);
+        if (paths[*count] == NULL) {
+            fprintf(stderr, "Error: Out of memory while reading batch list\n");
+            exit(1);
+        }
+        memcpy(paths[*count], line, len + 1);
+        /* The user id shares the path's allocation */
+        users[*count] = strchr(paths[*count], '\t');
+        if (users[*count] != NULL) {
+            *users[*count]++ = '\0';
+        }
+        (*count)++;
+    }
+    if (list != stdin) {
+        fclose(list);
+    }
+    *out = paths;
+    *out_users = users;
+    return 0;
+}
+
+/* Compile every file in the list; the loader reads ahead while we lex */
+static int run_batch(const char *list_path, const char *default_user, int prefetch,
+                     int max_autofix, int threads, int show_timing) {
+    AutofixContext autofix;
+    LoadedFile file;
+    Loader *loader;
+    char **paths;
+    char **users;
+    int count;
+    int unreadable = 0;
+    int bad_users = 0;
+    size_t total_bytes = 0;
+    double lex_ms = 0.0, parse_ms = 0.0, semantic_ms = 0.0;
+    double batch_start, batch_end;
+    int i;
+
+    if (read_path_list(list_path, &paths, &users, &count) != 0) {
+        fprintf(stderr, "Error: Cannot open batch list '%s'\n", list_path);
+        return 1;
+    }
+
+    autofix_context_init(&autofix);
+    autofix_set_max_per_run(&autofix, max_autofix);
+    parser_set_threads(threads);
+
+    batch_start = now_ms();
+    loader = loader_open((const char *const *)paths, count, prefetch, LOADER_INFLIGHT_BYTES);
+    while (loader_next(loader, &file)) {
+        Ast ast;
+        SymbolTable symbols;
+        TokenArray tokens;
+        double t0, t1, t2, t3;
+        int parsed;
+
+        printf("== %s\n", file.path);
+        if (file.data == NULL) {
+            fprintf(stderr, "Error: Cannot open file '%s'\n", file.path);
+            unreadable++;
+            loader_release(loader, &file);
+            continue;
+        }
+        total_bytes += file.size;
+        if (select_user(users[file.index] != NULL ? users[file.index] : default_user) != 0) {
+            bad_users++;
+            loader_release(loader, &file);
+            continue;
+        }
+
+        /* Each file is its own run as far as auto-fix limits go */
+        autofix_reset_count(&autofix);
+        autofix_reset_lines(&autofix);
+        ast_init(&ast);
+        symbol_table_init(&symbols);
+        token_array_init(&tokens);
+        error_tracker_set_source(file.path);
+
+        t0 = now_ms();
+        init_lexer_buffer(file.data, file.size);
+        lex_all(&tokens);
+        close_lexer();
+        t1 = now_ms();
+        parser_init(&autofix, &ast);
+        parsed = parse_program_tokens(&tokens);
+        parser_close();
+        t2 = now_ms();
+        if (parsed) {
+            semantic_check(&ast, &symbols);
+        }
+        t3 = now_ms();
+
+        lex_ms += t1 - t0;
+        parse_ms += t2 - t1;
+        semantic_ms += t3 - t2;
+
+        token_array_free(&tokens);
+        symbol_table_free(&symbols);
+        ast_free(&ast);
+        loader_release(loader, &file);
+    }
+    batch_end = now_ms();
+
+    if (show_timing) {
+        double elapsed = batch_end - batch_start;
+        printf("Batch report:\n");
+        printf("  files:       %d (%d unreadable, %d bad user id, %zu bytes)\n", count, unreadable,
+               bad_users, total_bytes);
+        printf("  io wait:     %.3f ms (%s, prefetch %d)\n", loader_wait_ms(loader),
+               loader_backend_name(loader_backend(loader)), prefetch);
+        printf("  lex:         %.3f ms\n", lex_ms);
+        printf("  parse:       %.3f ms\n", parse_ms);
+        printf("  semantic:    %.3f ms\n", semantic_ms);
+        printf("  total:       %.3f ms (%.0f files/s)\n", elapsed,
+               elapsed > 0.0 ? count * 1000.0 / elapsed : 0.0);
+    }
+
+    loader_close(loader);
+    for (i = 0; i < count; i++) {
+        free(paths[i]);
+    }
+    free(paths);
+    free(users);
+    autofix_context_free(&autofix);
+    return unreadable > 0 || bad_users > 0 ? 1 : 0;
 }
 
 int main(int argc, char *argv[]) {
+    const char *source_path = NULL;
+    int max_autofix = MAX_AUTOFIX_PER_RUN;
+    int show_timing = 0;
+    const char *emit_tokens_path = NULL;
+    const char *load_tokens_path = NULL;
+    const char *batch_path = NULL;
+    int prefetch = LOADER_PREFETCH_FILES;
+    int use_sketch = 0;
+    size_t sketch_bytes = 0;
+    const char *user = NULL;
+    int threads = 0;
+    int run = 0;
+    int bench = 0;
+    ExecOptions exec_options;
+    long long number;
+    int i;
+
+    exec_options_init(&exec_options);
+
     if (argc > 1 && strcmp(argv[1], "--help") == 0) {
         printf("HASC Compiler - Habit-Aware Adaptive Compiler\n");
         printf("Usage:\n");
         printf("  hasc <source_file>     Compile and analyze source file\n");
+        printf("  hasc -                 Compile a program read from stdin\n");
+        printf("  hasc --max-autofix N   Allow at most N auto-fixes per run (default %d)\n",
+               MAX_AUTOFIX_PER_RUN);
+        printf("  hasc --threads N       Parse function bodies on N threads (default: all cores)\n");
+        printf("  hasc --time            Print a phase timing report after compiling\n");
+        printf("  hasc --emit-tokens F   Also write the token stream to F in binary form\n");
+        printf("  hasc --load-tokens F   Compile a token stream written by --emit-tokens\n");
+        printf("  hasc --run             Run the program after a clean compile\n");
+        printf("  hasc --tier-up N       Compile a loop to bytecode after N iterations (default %d,\n",
+               EXEC_TIER_UP_BACKEDGES);
+        printf("                         0 = on entry, -1 = never)\n");
+        printf("  hasc --max-steps N     Stop a run after N loop iterations (default %lld, 0 = none)\n",
+               EXEC_MAX_STEPS);
+        printf("  hasc --bench           Time the program in the interpreter, tiered and as bytecode\n");
+        printf("  hasc --batch LIST      Compile every file listed in LIST, one path per line\n");
+        printf("                         ('-' reads the list from stdin)\n");
+        printf("  hasc --prefetch N      Read up to N batch files ahead (default %d, 0 = off)\n",
+               LOADER_PREFETCH_FILES);
+        printf("  hasc --sketch[=BYTES]  Count habits in a fixed-size sketch instead of scanning\n");
+        printf("                         the whole history (new sketch: BYTES, default %u;\n",
+               HABIT_SKETCH_BYTES);
+        printf("                         mistakes are then not logged for --habits)\n");
+        printf("  hasc --sketch-audit    Compare the habit sketch against exact counts\n");
+        printf("  hasc --user ID         Use ID's habit profile (also with --habits, --reset,\n");
+        printf("                         --sketch-audit; batch lists may give \"path<TAB>ID\")\n");
+        printf("  hasc --habits [--top N] [--json]\n");
+        printf("                         Report the most frequent mistakes in the habit history\n");
         printf("  hasc --reset           Reset habit detection history\n");
         printf("  hasc --help            Show this help message\n");
         return 0;
     }
 
-    if (argc > 1 && strcmp(argv[1], "--reset") == 0) {
-        autofix_reset_count();
-        autofix_reset_lines();
+    if (argc > 1 && (strcmp(argv[1], "--reset") == 0 || strcmp(argv[1], "--sketch-audit") == 0)) {
+        const char *user = NULL;
+
+        for (i = 2; i < argc; i++) {
+            if (!match_user_option(argc, argv, &i, &user)) {
+                fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]);
+                print_usage(stderr);
+                return 1;
+            }
+        }
+        if (select_user(user) != 0) {
+            return 1;
+        }
+    }
 
-        if (remove("data/user_profile.dat") == 0) {
+    if (argc > 1 && strcmp(argv[1], "--reset") == 0) {
+        if (profile_reset() == 0) {
             printf("Habit history reset successfully.\n");
         } else {
             printf("No habit history found to reset.\n");
@@ -39,24 +389,233 @@ int main(int argc, char *argv[]) {
         return 0;
     }
 
-    if (argc == 1) {
-        fprintf(stderr, "Usage: hasc <source_file> | --reset | --help\n");
+    if (argc > 1 && strcmp(argv[1], "--sketch-audit") == 0) {
+        if (habit_sketch_audit(stdout) != 0) {
+            printf("No habit sketch or history found.\n");
+        }
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--habits") == 0) {
+        int top_n = 10;
+        HabitsFormat format = HABITS_TEXT;
+        const char *user = NULL;
+
+        for (i = 2; i < argc; i++) {
+            if (match_user_option(argc, argv, &i, &user)) {
+                continue;
+            } else if (strcmp(argv[i], "--json") == 0) {
+                format = HABITS_JSON;
+            } else if (match_number_option(argc, argv, &i, "--top", 1, INT_MAX, &number)) {
+                top_n = (int)number;
+            } else {
+                fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]);
+                print_usage(stderr);
+                return 1;
+            }
+        }
+
+        if (select_user(user) != 0) {
+            return 1;
+        }
+        if (habits_report(stdout, top_n, format) != 0) {
+            printf("No habit history found.\n");
+        }
+        return 0;
+    }
+
+    for (i = 1; i < argc; i++) {
+        if (match_number_option(argc, argv, &i, "--max-autofix", 0, INT_MAX, &number)) {
+            max_autofix = (int)number;
+        } else if (match_number_option(argc, argv, &i, "--threads", 0, INT_MAX, &number)) {
+            threads = (int)number;
+        } else if (strcmp(argv[i], "--time") == 0) {
+            show_timing = 1;
+        } else if (strcmp(argv[i], "--emit-tokens") == 0 && i + 1 < argc) {
+            emit_tokens_path = argv[++i];
+        } else if (strncmp(argv[i], "--emit-tokens=", 14) == 0) {
+            emit_tokens_path = argv[i] + 14;
+        } else if (strcmp(argv[i], "--load-tokens") == 0 && i + 1 < argc) {
+            load_tokens_path = argv[++i];
+        } else if (strncmp(argv[i], "--load-tokens=", 14) == 0) {
+            load_tokens_path = argv[i] + 14;
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batch_path = argv[++i];
+        } else if (strncmp(argv[i], "--batch=", 8) == 0) {
+            batch_path = argv[i] + 8;
+        } else if (match_number_option(argc, argv, &i, "--prefetch", 0, LOADER_MAX_PREFETCH,
+                                       &number)) {
+            prefetch = (int)number;
+        } else if (strcmp(argv[i], "--run") == 0) {
+            run = 1;
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            bench = 1;
+        } else if (match_number_option(argc, argv, &i, "--tier-up", -1, LONG_MAX, &number)) {
+            exec_options.tier_up = (long)number;
+        } else if (match_number_option(argc, argv, &i, "--max-steps", 0, LLONG_MAX, &number)) {
+            exec_options.max_steps = number;
+        } else if (match_user_option(argc, argv, &i, &user)) {
+            continue;
+        } else if (strcmp(argv[i], "--sketch") == 0) {
+            use_sketch = 1;
+        } else if (strncmp(argv[i], "--sketch=", 9) == 0) {
+            use_sketch = 1;
+            sketch_bytes = (size_t)parse_number("--sketch", argv[i] + 9, 0, HABIT_SKETCH_MAX_BYTES);
+        } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+            fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]);
+            print_usage(stderr);
+            return 1;
+        } else if (source_path == NULL) {
+            source_path = argv[i];
+        } else {
+            print_usage(stderr);
+            return 1;
+        }
+    }
+
+    if (batch_path != NULL) {
+        int status;
+
+        if (source_path != NULL || load_tokens_path != NULL || emit_tokens_path != NULL ||
+            run || bench) {
+            print_usage(stderr);
+            return 1;
+        }
+        if (use_sketch) {
+            habit_sketch_enable(sketch_bytes);
+        }
+        status = run_batch(batch_path, user, prefetch, max_autofix, threads, show_timing);
+        profile_store_close();
+        return status;
+    }
+
+    if ((source_path == NULL) == (load_tokens_path == NULL)) {
+        print_usage(stderr);
         return 1;
     }
 
-    if (argc != 2) {
-        fprintf(stderr, "Usage: hasc <source_file> | --reset | --help\n");
+    if (select_user(user) != 0) {
         return 1;
     }
+    if (use_sketch) {
+        habit_sketch_enable(sketch_bytes);
+    }
 
-    init_lexer(argv[1]);
-    autofix_reset_count();
-    autofix_reset_lines();
+    AutofixContext autofix;
+    autofix_context_init(&autofix);
+    autofix_set_max_per_run(&autofix, max_autofix);
 
-    parser_init();
-    parse_program();
-    parser_close();
+    Ast ast;
+    SymbolTable symbols;
+    TokenArray tokens;
+    double lex_start, lex_end, parse_end, check_end;
+    int parsed;
+    int checked = 0;
+    ExecStats exec_stats;
+    double exec_ms = -1.0;
+    int status = 0;
+    StreamCheck stream;
+    int streamed = 0;
+
+    memset(&stream, 0, sizeof(stream));
 
+    ast_init(&ast);
+    symbol_table_init(&symbols);
+    token_array_init(&tokens);
+
+    if (load_tokens_path != NULL) {
+        error_tracker_set_source(load_tokens_path);
+    } else {
+        error_tracker_set_source(strcmp(source_path, "-") == 0 ? "<stdin>" : source_path);
+    }
+
+    lex_start = now_ms();
+    parser_init(&autofix, &ast);
+    parser_set_threads(threads);
+
+    if (load_tokens_path != NULL) {
+        /* Cached token stream: no lexing at all */
+        if (token_file_load(load_tokens_path, &tokens) != 0) {
+            fprintf(stderr, "Error: Cannot load token file '%s'\n", load_tokens_path);
+            exit(1);
+        }
+        lex_end = now_ms();
+        parsed = parse_program_tokens(&tokens);
+    } else if (strcmp(source_path, "-") == 0 && emit_tokens_path == NULL) {
+        /* Keep stdin streaming: lex, parse and, unless the program is to
+         * run, check it in one pass that never holds the whole input */
+        init_lexer(source_path);
+        lex_end = lex_start;
+        if (!run && !bench) {
+            streamed = 1;
+            semantic_begin(&symbols);
+            parser_set_sink(check_streamed, &stream);
+        }
+        parsed = parse_program();
+        parser_set_sink(NULL, NULL);
+    } else {
+        init_lexer(source_path);
+        lex_all(&tokens);
+        lex_end = now_ms();
+        if (emit_tokens_path != NULL && token_file_write(emit_tokens_path, &tokens) != 0) {
+            fprintf(stderr, "Error: Cannot write token file '%s'\n", emit_tokens_path);
+        }
+        parsed = parse_program_tokens(&tokens);
+    }
+
+    parser_close();
     close_lexer();
-    return 0;
+    parse_end = now_ms();
+
+    if (streamed) {
+        /* Already checked as it was parsed */
+        checked = semantic_end(parsed) == 0 && parsed;
+        parse_end -= stream.semantic_ms;
+    } else if (parsed) {
+        checked = semantic_check(&ast, &symbols) == 0;
+    }
+    check_end = now_ms();
+
+    /* Only a program that compiled cleanly runs */
+    if (checked && bench) {
+        exec_benchmark(&ast, symbols.symbol_count, &exec_options, stdout);
+    } else if (checked && run) {
+        double exec_start = now_ms();
+        if (execute_program(&ast, symbols.symbol_count, &exec_options, &exec_stats) != EXEC_OK) {
+            status = 1;
+        }
+        exec_ms = now_ms() - exec_start;
+    }
+
+    if (show_timing) {
+        printf("Timing report:\n");
+        if (tokens.count > 0) {
+            printf("  %s        %.3f ms (%d tokens)\n", load_tokens_path != NULL ? "load:" : "lex: ",
+                   lex_end - lex_start, tokens.count);
+            printf("  parse:       %.3f ms (%d functions, %d statements, %d expression nodes)\n",
+                   parse_end - lex_end, ast.function_count, ast.stmt_count, ast.expr_count);
+        } else {
+            /* Streamed: what was dropped plus what is still held */
+            printf("  lex+parse:   %.3f ms (%d functions, %lld statements, %lld expression nodes)\n",
+                   parse_end - lex_start, stream.functions + ast.function_count,
+                   stream.stmts + ast.stmt_count, stream.exprs + ast.expr_count);
+        }
+        printf("  semantic:    %.3f ms\n", check_end - parse_end + stream.semantic_ms);
+        if (exec_ms >= 0.0) {
+            printf("  execute:     %.3f ms (%lld ops, %lld back-edges, %d loops compiled in %.3f ms)\n",
+                   exec_ms, exec_stats.ops, exec_stats.back_edges, exec_stats.loops_compiled,
+                   exec_stats.compile_ms);
+        }
+        if (peak_memory_kib() >= 0) {
+            printf("  peak memory: %ld KiB\n", peak_memory_kib());
+        }
+        symbol_table_print_stats(&symbols, stdout);
+    }
+
+    token_array_free(&tokens);
+    symbol_table_free(&symbols);
+    ast_free(&ast);
+    autofix_context_free(&autofix);
+    profile_store_close();
+    return status;
 }
@@ -1,146 +1,938 @@
 // Syntax analyzer
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
 
 #include "lexer.h"
+#include "ast.h"
 #include "parser.h"
 #include "error_tracker.h"
 #include "threshold.h"
 #include "autofix.h"
 #include "highlighter.h"
+#include "error_handler.h"
 
-static const char* parser_token_type_to_string(TokenType type) {
-    switch (type) {
-        case TOKEN_KEYWORD:    return "TOKEN_KEYWORD";
-        case TOKEN_IDENTIFIER: return "TOKEN_IDENTIFIER";
-        case TOKEN_NUMBER:     return "TOKEN_NUMBER";
-        case TOKEN_SYMBOL:     return "TOKEN_SYMBOL";
-        case TOKEN_EOF:        return "TOKEN_EOF";
-        case TOKEN_UNKNOWN:    return "TOKEN_UNKNOWN";
-        default:               return "UNKNOWN";
+/* Explicit stacks for the expression parser, reused across expressions */
+#define EXPR_MARK_LPAREN (-1)
+#define EXPR_MARK_NEGATE (-2)
+#define NEGATE_PRECEDENCE 5
+
+typedef struct {
+    int op;               /* BinaryOp or one of the EXPR_MARK_* markers */
+    int line;
+    int column;
+} OperatorEntry;
+
+/* Explicit stack of open blocks, so nesting depth costs heap, not C stack */
+typedef enum {
+    BLOCK_FUNCTION,
+    BLOCK_IF,
+    BLOCK_ELSE,
+    BLOCK_WHILE
+} BlockKind;
+
+typedef struct {
+    int kind;             /* BlockKind */
+    int stmt;             /* statement that owns the body, -1 for the function */
+    int line;             /* position of the opening '{' */
+    int column;
+} BlockFrame;
+
+/* A repair spliced into the token array: insert `token` in front of
+ * tokens[at], or skip tokens[at]. The array itself is never modified. */
+typedef struct {
+    int at;
+    int kind;             /* RepairKind */
+    Token token;
+} TokenEdit;
+
+/*
+ * All state of one parse. Tokens come either from a slice [pos, end) of a
+ * lexed TokenArray or, when `tokens` is NULL, straight from the lexer.
+ * A quiet parser reports nothing and only records that it failed; it is
+ * used to parse function bodies speculatively on worker threads and to
+ * try out repairs.
+ */
+typedef struct {
+    const TokenArray *tokens;
+    int pos;
+    int end;
+
+    /* Repairs in token order; edits[0, next_edit) are behind the cursor */
+    TokenEdit *edits;
+    int edit_count;
+    int edit_capacity;
+    int next_edit;
+
+    /* Cursor before the last next_token(), for push_back_token() */
+    int prev_pos;
+    int prev_next_edit;
+
+    /* Where the last token came from, i.e. where a repair for it goes */
+    int token_pos;
+    int token_edit;
+
+    /* Trial parses stop with EOF once the cursor reaches stop_pos, and
+     * do not skip over unknown statements starting at or after strict_from */
+    int stop_pos;
+    int strict_from;
+    int window_reached;
+
+    /* How far the current statement has got, so a repair trial can carry
+     * on from a copy of this state instead of reading the statement again:
+     * the rest of `pattern` from `step` (see parse_pattern()), then the
+     * block it opens. `pattern` is NULL between statements; `skipping` is
+     * set in a statement being skipped up to its ';'. */
+    const char *pattern;
+    int step;
+    int opens;            /* BlockKind, or -1 */
+    int skipping;
+
+    /* One token of lookahead: the expression parser reads the token that
+     * ends an expression and hands it back to the statement parser. When
+     * reading straight from the lexer, a repair injects one more token in
+     * front of it. */
+    Token pending;
+    int has_pending;
+    Token injected;
+    int has_injected;
+
+    Ast *ast;
+    AutofixContext *autofix;
+    int quiet;
+    int failed;
+
+    BlockFrame *blocks;
+    int block_depth;
+    int block_capacity;
+
+    /* Shunting-yard state of the expression being read, and the token
+     * that ended the last one, which a repair may let it read past */
+    int expect_operand;
+    int open_parens;
+    int expr_end;
+    int expr_end_edit;
+    int *operands;
+    int operand_count;
+    int operand_capacity;
+    OperatorEntry *operators;
+    int operator_count;
+    int operator_capacity;
+} Parser;
+
+static Parser main_parser;
+static int parser_threads = 0;
+static ParseSinkFn parser_sink = NULL;
+static void *parser_sink_arg = NULL;
+
+static void parser_state_init(Parser *p, AutofixContext *autofix, Ast *ast) {
+    memset(p, 0, sizeof(*p));
+    p->autofix = autofix;
+    p->ast = ast;
+    p->stop_pos = -1;
+    p->strict_from = -1;
+}
+
+static void parser_state_free(Parser *p) {
+    free(p->blocks);
+    free(p->operands);
+    free(p->operators);
+    free(p->edits);
+    p->edits = NULL;
+    p->edit_count = p->edit_capacity = p->next_edit = 0;
+    p->blocks = NULL;
+    p->operands = NULL;
+    p->operators = NULL;
+    p->block_depth = p->block_capacity = 0;
+    p->operand_count = p->operand_capacity = 0;
+    p->operator_count = p->operator_capacity = 0;
+}
+
+void parser_init(AutofixContext *autofix, Ast *ast) {
+    parser_state_init(&main_parser, autofix, ast);
+}
+
+void parser_set_threads(int threads) {
+    parser_threads = threads;
+}
+
+void parser_set_sink(ParseSinkFn sink, void *arg) {
+    parser_sink = sink;
+    parser_sink_arg = arg;
+}
+
+static Token eof_token(const Parser *p) {
+    /* Past the end of the slice: behave like the lexer at end of input */
+    Token eof = token_array_at(p->tokens, p->end > 0 ? p->end - 1 : 0);
+    eof.type = TOKEN_EOF;
+    eof.lexeme[0] = '\0';
+    return eof;
+}
+
+static Token next_token(Parser *p) {
+    if (p->tokens == NULL) {
+        if (p->has_injected) {
+            p->has_injected = 0;
+            return p->injected;
+        }
+        if (p->has_pending) {
+            p->has_pending = 0;
+            return p->pending;
+        }
+        return get_next_token();
+    }
+
+    p->prev_pos = p->pos;
+    p->prev_next_edit = p->next_edit;
+
+    for (;;) {
+        p->token_pos = p->pos;
+        p->token_edit = p->next_edit;
+
+        if (p->stop_pos >= 0 && p->pos >= p->stop_pos) {
+            p->window_reached = 1;
+            return eof_token(p);
+        }
+        if (p->next_edit < p->edit_count && p->edits[p->next_edit].at == p->pos) {
+            const TokenEdit *edit = &p->edits[p->next_edit++];
+            if (edit->kind == REPAIR_INSERT) {
+                return edit->token;
+            }
+            p->pos++; /* REPAIR_DELETE */
+            continue;
+        }
+        if (p->pos < p->end) {
+            return token_array_at(p->tokens, p->pos++);
+        }
+        return eof_token(p);
     }
 }
 
-void parser_init(void) {
-    /* No parser state to initialize yet */
+/* Hand back the token just read; only one token can be pushed back */
+static void push_back_token(Parser *p, const Token *token) {
+    if (p->tokens == NULL) {
+        p->pending = *token;
+        p->has_pending = 1;
+        return;
+    }
+    p->pos = p->prev_pos;
+    p->next_edit = p->prev_next_edit;
+}
+
+/* Move the cursor of a token-array parse forward to `pos` */
+static void seek_token(Parser *p, int pos) {
+    p->pos = pos;
+    while (p->next_edit < p->edit_count && p->edits[p->next_edit].at < pos) {
+        p->next_edit++;
+    }
+}
+
+static void *grow_stack(void *data, int *capacity, size_t elem_size) {
+    int new_capacity = *capacity ? *capacity * 2 : 64;
+    void *grown = realloc(data, (size_t)new_capacity * elem_size);
+    if (grown == NULL) {
+        fprintf(stderr, "Error: Out of memory while parsing expression\n");
+        exit(1);
+    }
+    *capacity = new_capacity;
+    return grown;
+}
+
+static int parse_function(Parser *p);
+static int parse_block_body(Parser *p, int function);
+static int resume_statement(Parser *p);
+static void push_operand(Parser *p, int node);
+
+static void push_frame(Parser *p, const BlockFrame *frame) {
+    if (p->block_depth == p->block_capacity) {
+        p->blocks = grow_stack(p->blocks, &p->block_capacity, sizeof(BlockFrame));
+    }
+    p->blocks[p->block_depth++] = *frame;
 }
 
-static AutofixResult report_syntax_error(const char *expected_type,
-                                         const char *expected_lexeme,
-                                         const Token *token) {
+/* Note that a new statement (or function header) is about to be read */
+static void mark_statement(Parser *p) {
+    p->pattern = NULL;
+    p->skipping = 0;
+}
+
+static void set_edit(TokenEdit *edit, int at, const RepairCandidate *repair, const Token *token) {
+    edit->at = at;
+    edit->kind = repair->kind;
+    edit->token = *token;
+    if (repair->kind == REPAIR_INSERT) {
+        edit->token.type = TOKEN_SYMBOL;
+        strcpy(edit->token.lexeme, repair->lexeme);
+    }
+}
+
+/*
+ * Carry on quietly from the state at the error with `candidate` applied
+ * at the error token and report how far past the error it gets
+ * (RepairTrial.run). The trial reads the same token array from a copy of
+ * that state: where the statement had got to, the open expression's
+ * stacks and only the innermost blocks, because the window cannot close
+ * more of them than it has tokens. The statement so far is not re-read.
+ */
+static int run_repair_trial(void *arg, const RepairCandidate *candidate) {
+    const Parser *p = arg;
+    Parser trial;
+    Ast scratch;
+    Token error_token;
+    int first_kept = p->token_pos + (candidate->kind == REPAIR_DELETE ? 1 : 0);
+    int copied = p->block_depth < REPAIR_WINDOW + 2 ? p->block_depth : REPAIR_WINDOW + 2;
+    int progress;
+    int ok;
+    int i;
+
+    ast_init(&scratch);
+    parser_state_init(&trial, NULL, &scratch);
+    trial.quiet = 1;
+    trial.tokens = p->tokens;
+    trial.end = p->end;
+    trial.pos = p->token_pos;
+    trial.stop_pos = first_kept + REPAIR_WINDOW;
+    trial.strict_from = first_kept;
+
+    trial.edits = grow_stack(NULL, &trial.edit_capacity, sizeof(TokenEdit));
+    error_token = token_array_at(p->tokens, p->token_pos < p->end ? p->token_pos : p->end - 1);
+    set_edit(&trial.edits[0], p->token_pos, candidate, &error_token);
+    trial.edit_count = 1;
+
+    for (i = 0; i < copied; i++) {
+        BlockFrame frame = p->blocks[p->block_depth - copied + i];
+        frame.stmt = -1; /* owned by the real AST, not the scratch one */
+        push_frame(&trial, &frame);
+    }
+
+    trial.pattern = p->pattern;
+    trial.step = p->step;
+    trial.opens = p->opens;
+    trial.skipping = p->skipping;
+    if (p->pattern != NULL && p->step > 0 && p->pattern[p->step - 1] == 'e' &&
+        p->token_pos == p->expr_end && p->token_edit == p->expr_end_edit) {
+        /* Deleting the token that ended the expression lets it go on */
+        trial.step--;
+    }
+    if (trial.pattern != NULL && trial.pattern[trial.step] == 'e') {
+        /* Operand indices point into the real AST; the trial only
+         * combines them into scratch nodes nobody reads */
+        trial.expect_operand = p->expect_operand;
+        trial.open_parens = p->open_parens;
+        for (i = 0; i < p->operand_count; i++) {
+            push_operand(&trial, p->operands[i]);
+        }
+        while (trial.operator_capacity < p->operator_count) {
+            trial.operators = grow_stack(trial.operators, &trial.operator_capacity,
+                                         sizeof(OperatorEntry));
+        }
+        for (i = 0; i < p->operator_count; i++) {
+            trial.operators[i] = p->operators[i];
+        }
+        trial.operator_count = p->operator_count;
+    }
+
+    ok = resume_statement(&trial) && parse_block_body(&trial, -1);
+
+    if ((ok && !trial.failed) || trial.window_reached) {
+        progress = REPAIR_WINDOW;
+    } else {
+        progress = trial.token_pos - first_kept;
+        if (progress < 0) {
+            progress = 0;
+        }
+    }
+
+    parser_state_free(&trial);
+    ast_free(&scratch);
+    return progress;
+}
+
+/* Splice a chosen repair in front of `token` and hand `token` back unread */
+static void apply_repair(Parser *p, const RepairCandidate *repair, const Token *token) {
+    if (p->tokens == NULL) {
+        /* Straight from the lexer only insertions are possible */
+        TokenEdit edit;
+        set_edit(&edit, 0, repair, token);
+        p->injected = edit.token;
+        p->has_injected = 1;
+        push_back_token(p, token);
+        return;
+    }
+
+    if (p->edit_count == p->edit_capacity) {
+        p->edits = grow_stack(p->edits, &p->edit_capacity, sizeof(TokenEdit));
+    }
+    memmove(&p->edits[p->token_edit + 1], &p->edits[p->token_edit],
+            (size_t)(p->edit_count - p->token_edit) * sizeof(TokenEdit));
+    set_edit(&p->edits[p->token_edit], p->token_pos, repair, token);
+    p->edit_count++;
+
+    p->pos = p->token_pos;
+    p->next_edit = p->token_edit;
+}
+
+/*
+ * Offer a habitual mistake to the repair engine. Token-array input gets
+ * its candidates scored by trial parses; lexer input, which cannot be
+ * re-read, keeps the conservative missing-';' rule. On success the caller
+ * just reads again.
+ */
+static AutofixResult try_repair(Parser *p, ErrorCode code, const Token *token) {
+    RepairTrial trial;
+    RepairCandidate repair;
+    int repairable;
+
+    if (p->tokens != NULL) {
+        repairable = error_repair_symbol(code) != 0;
+    } else {
+        repairable = is_safe_autofix_error(code, token);
+    }
+    if (!repairable) {
+        return AUTOFIX_NOT_APPLIED;
+    }
+
+    if (autofix_already_applied_on_line(p->autofix, token->line)) {
+        printf("Auto-fix already applied on this line. Skipping.\n");
+        return AUTOFIX_NOT_APPLIED;
+    }
+    if (autofix_limit_reached(p->autofix)) {
+        printf("Auto-fix limit reached. Further errors require manual correction.\n");
+        return AUTOFIX_NOT_APPLIED;
+    }
+
+    trial.run = run_repair_trial;
+    trial.arg = p;
+    if (autofix_try(code, token, p->tokens != NULL ? &trial : NULL, &repair) != AUTOFIX_APPLIED) {
+        return AUTOFIX_NOT_APPLIED;
+    }
+
+    autofix_record_applied(p->autofix);
+    autofix_record_line(p->autofix, token->line);
+    if (repair.kind == REPAIR_INSERT) {
+        printf("Auto-fix applied (execution-only): missing '%s'\n", repair.lexeme);
+    } else {
+        printf("Auto-fix applied (execution-only): removed unexpected '%s'\n", token->lexeme);
+    }
+    printf("Warning: This error was automatically corrected for execution only. Please fix it in your source code.\n");
+    apply_repair(p, &repair, token);
+    return AUTOFIX_APPLIED;
+}
+
+static AutofixResult report_syntax_error(Parser *p, ErrorCode code, const Token *token) {
+    if (p->quiet) {
+        p->failed = 1;
+        return AUTOFIX_NOT_APPLIED;
+    }
+
     printf("Syntax error: expected %s \"%s\" but got %s \"%s\" "
            "at line %d, column %d\n",
-           expected_type,
-           expected_lexeme,
-           parser_token_type_to_string(token->type),
+           error_expected_type(code),
+           error_expected_lexeme(code),
+           token_type_to_string(token->type),
            token->lexeme,
            token->line,
            token->column);
     
-    error_tracker_log("syntax_error", expected_type, expected_lexeme, token);
+    error_tracker_log(code, token);
 
-    int is_habit_detected = threshold_check("syntax_error", expected_type, expected_lexeme, token);
+    int is_habit_detected = threshold_check(code, token);
     if (is_habit_detected) {
         printf("Notice: This appears to be a repeated (habitual) mistake.\n");
-        if (is_safe_autofix_error(expected_lexeme, parser_token_type_to_string(token->type))) {
-            if (autofix_already_applied_on_line(token->line)) {
-                printf("Auto-fix already applied on this line. Skipping.\n");
-            } else if (autofix_limit_reached()) {
-                printf("Auto-fix limit reached. Further errors require manual correction.\n");
-            } else if (autofix_try("syntax_error", expected_type, expected_lexeme, token) == AUTOFIX_APPLIED) {
-                autofix_record_applied();
-                autofix_record_line(token->line);
-                printf("Auto-fix applied (execution-only): missing ';'\n");
-                printf("Warning: This error was automatically corrected for execution only. Please fix it in your source code.\n");
-                highlight_error("syntax_error", expected_type, expected_lexeme, token);
-                return AUTOFIX_APPLIED;
-            }
+        if (try_repair(p, code, token) == AUTOFIX_APPLIED) {
+            highlight_error(code, token);
+            return AUTOFIX_APPLIED;
         }
     }
     
-    highlight_error("syntax_error", expected_type, expected_lexeme, token);
+    highlight_error(code, token);
     return AUTOFIX_NOT_APPLIED;
 }
 
-void parse_program(void) {
+/* Read the next token and require the symbol `code` says is missing,
+ * reading again after a repair. Returns 0 once the error is reported. */
+static int expect_symbol(Parser *p, ErrorCode code, Token *out) {
+    const char *lexeme = error_expected_lexeme(code);
+
+    for (;;) {
+        Token token = next_token(p);
+        if (token.type == TOKEN_SYMBOL && strcmp(token.lexeme, lexeme) == 0) {
+            if (out != NULL) {
+                *out = token;
+            }
+            return 1;
+        }
+        if (report_syntax_error(p, code, &token) != AUTOFIX_APPLIED) {
+            return 0;
+        }
+    }
+}
+
+static void push_operand(Parser *p, int node) {
+    if (p->operand_count == p->operand_capacity) {
+        p->operands = grow_stack(p->operands, &p->operand_capacity, sizeof(int));
+    }
+    p->operands[p->operand_count++] = node;
+}
+
+static void push_operator(Parser *p, int op, const Token *token) {
+    if (p->operator_count == p->operator_capacity) {
+        p->operators = grow_stack(p->operators, &p->operator_capacity, sizeof(OperatorEntry));
+    }
+    p->operators[p->operator_count].op = op;
+    p->operators[p->operator_count].line = token->line;
+    p->operators[p->operator_count].column = token->column;
+    p->operator_count++;
+}
+
+static void push_block(Parser *p, BlockKind kind, int stmt, const Token *open_brace) {
+    BlockFrame frame;
+
+    frame.kind = kind;
+    frame.stmt = stmt;
+    frame.line = open_brace->line;
+    frame.column = open_brace->column;
+    push_frame(p, &frame);
+}
+
+static int binary_op_from_token(const Token *token) {
+    if (token->type != TOKEN_SYMBOL) {
+        return -1;
+    }
+    if (strcmp(token->lexeme, "+") == 0)  return OP_ADD;
+    if (strcmp(token->lexeme, "-") == 0)  return OP_SUB;
+    if (strcmp(token->lexeme, "*") == 0)  return OP_MUL;
+    if (strcmp(token->lexeme, "/") == 0)  return OP_DIV;
+    if (strcmp(token->lexeme, "<") == 0)  return OP_LT;
+    if (strcmp(token->lexeme, ">") == 0)  return OP_GT;
+    if (strcmp(token->lexeme, "<=") == 0) return OP_LE;
+    if (strcmp(token->lexeme, ">=") == 0) return OP_GE;
+    if (strcmp(token->lexeme, "==") == 0) return OP_EQ;
+    if (strcmp(token->lexeme, "!=") == 0) return OP_NE;
+    return -1;
+}
+
+static int operator_precedence(int op) {
+    switch (op) {
+        case EXPR_MARK_NEGATE:
+            return NEGATE_PRECEDENCE;
+        case OP_MUL:
+        case OP_DIV:
+            return 4;
+        case OP_ADD:
+        case OP_SUB:
+            return 3;
+        case OP_LT:
+        case OP_GT:
+        case OP_LE:
+        case OP_GE:
+            return 2;
+        case OP_EQ:
+        case OP_NE:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Pop the top operator and combine it with its operands into a new node */
+static void reduce_operator(Parser *p) {
+    OperatorEntry entry = p->operators[--p->operator_count];
+    ExprNode node;
+
+    node.line = entry.line;
+    node.column = entry.column;
+    node.slot = -1;
+    node.op = 0;
+
+    if (entry.op == EXPR_MARK_NEGATE) {
+        node.kind = EXPR_NEGATE;
+        node.as.operand = p->operands[--p->operand_count];
+    } else {
+        node.kind = EXPR_BINARY;
+        node.op = (unsigned char)entry.op;
+        node.as.bin.rhs = p->operands[--p->operand_count];
+        node.as.bin.lhs = p->operands[--p->operand_count];
+    }
+
+    push_operand(p, ast_add_expr(p->ast, &node));
+}
+
+/*
+ * Parse an expression with operator-precedence (shunting-yard) parsing.
+ * Operators and pending operands are kept on explicit heap stacks, so the
+ * cost is linear in the number of tokens and nesting depth never touches
+ * the C call stack. The token that ends the expression is pushed back.
+ * Returns 1 and stores the root node index on success, 0 after reporting
+ * a syntax error. With `resume` set it continues the expression whose
+ * state is already in `p`, as a repair trial does.
+ */
+static int parse_expression(Parser *p, int *result, int resume) {
     Token token;
 
-    /* Expect: int */
-    token = get_next_token();
-    if (!(token.type == TOKEN_KEYWORD && strcmp(token.lexeme, "int") == 0)) {
-        report_syntax_error("TOKEN_KEYWORD", "int", &token);
-        return;
+    if (!resume) {
+        p->expect_operand = 1;
+        p->open_parens = 0;
+        p->operand_count = 0;
+        p->operator_count = 0;
     }
 
-    /* Expect: main */
-    token = get_next_token();
-    if (!(token.type == TOKEN_KEYWORD && strcmp(token.lexeme, "main") == 0)) {
-        report_syntax_error("TOKEN_KEYWORD", "main", &token);
-        return;
+    for (;;) {
+        token = next_token(p);
+
+        if (p->expect_operand) {
+            if (token.type == TOKEN_IDENTIFIER || token.type == TOKEN_NUMBER) {
+                ExprNode node;
+                node.line = token.line;
+                node.column = token.column;
+                node.slot = -1;
+                node.op = 0;
+                if (token.type == TOKEN_NUMBER) {
+                    node.kind = EXPR_NUMBER;
+                    node.as.number = strtoll(token.lexeme, NULL, 10);
+                } else {
+                    node.kind = EXPR_IDENTIFIER;
+                    node.as.name = ast_add_name(p->ast, token.lexeme);
+                }
+                push_operand(p, ast_add_expr(p->ast, &node));
+                p->expect_operand = 0;
+            } else if (token.type == TOKEN_SYMBOL && strcmp(token.lexeme, "(") == 0) {
+                push_operator(p, EXPR_MARK_LPAREN, &token);
+                p->open_parens++;
+            } else if (token.type == TOKEN_SYMBOL && strcmp(token.lexeme, "-") == 0) {
+                /* Prefix minus binds tighter than anything, so nothing is reduced */
+                push_operator(p, EXPR_MARK_NEGATE, &token);
+            } else {
+                report_syntax_error(p, E_EXPECTED_OPERAND, &token);
+                return 0;
+            }
+            continue;
+        }
+
+        int op = binary_op_from_token(&token);
+        if (op >= 0) {
+            /* All binary operators are left-associative */
+            int precedence = operator_precedence(op);
+            while (p->operator_count > 0 &&
+                   p->operators[p->operator_count - 1].op != EXPR_MARK_LPAREN &&
+                   operator_precedence(p->operators[p->operator_count - 1].op) >= precedence) {
+                reduce_operator(p);
+            }
+            push_operator(p, op, &token);
+            p->expect_operand = 1;
+            continue;
+        }
+
+        if (p->open_parens > 0 && token.type == TOKEN_SYMBOL && strcmp(token.lexeme, ")") == 0) {
+            while (p->operators[p->operator_count - 1].op != EXPR_MARK_LPAREN) {
+                reduce_operator(p);
+            }
+            p->operator_count--;
+            p->open_parens--;
+            continue;
+        }
+
+        /* Any other token ends the expression */
+        if (p->open_parens > 0) {
+            if (report_syntax_error(p, E_MISSING_RPAREN, &token) == AUTOFIX_APPLIED) {
+                continue;
+            }
+            return 0;
+        }
+        break;
     }
 
-    /* Expect: ( */
-    token = get_next_token();
-    if (!(token.type == TOKEN_SYMBOL && strcmp(token.lexeme, "(") == 0)) {
-        report_syntax_error("TOKEN_SYMBOL", "(", &token);
-        return;
+    while (p->operator_count > 0) {
+        reduce_operator(p);
     }
 
-    /* Expect: ) */
-    token = get_next_token();
-    if (!(token.type == TOKEN_SYMBOL && strcmp(token.lexeme, ")") == 0)) {
-        report_syntax_error("TOKEN_SYMBOL", ")", &token);
-        return;
+    p->expr_end = p->token_pos;
+    p->expr_end_edit = p->token_edit;
+    push_back_token(p, &token);
+    *result = p->operands[0];
+    return 1;
+}
+
+/* The error for a missing pattern symbol */
+static ErrorCode pattern_error(char symbol) {
+    switch (symbol) {
+        case ';': return E_MISSING_SEMICOLON;
+        case '(': return E_MISSING_LPAREN;
+        case ')': return E_MISSING_RPAREN;
+        case '{': return E_MISSING_LBRACE;
+        default:  return E_MISSING_ASSIGN;
     }
+}
 
-    /* Expect: { */
-    token = get_next_token();
-    if (!(token.type == TOKEN_SYMBOL && strcmp(token.lexeme, "{") == 0)) {
-        report_syntax_error("TOKEN_SYMBOL", "{", &token);
-        return;
+/*
+ * Read the rest of a statement from p->pattern, starting at p->step.
+ * Each character of a pattern is a symbol to expect, except 'e', an
+ * expression whose root is stored in *expr (continued rather than
+ * started when `in_expression` is set). The last symbol read is stored in
+ * *last (may be NULL). Returns 0 after an error that was not repaired.
+ */
+static int continue_pattern(Parser *p, int in_expression, int *expr, Token *last) {
+    for (; p->pattern[p->step] != '\0'; p->step++) {
+        char symbol = p->pattern[p->step];
+
+        if (symbol == 'e') {
+            if (!parse_expression(p, expr, in_expression)) {
+                return 0;
+            }
+            in_expression = 0;
+        } else if (!expect_symbol(p, pattern_error(symbol), last)) {
+            return 0;
+        }
     }
+    return 1;
+}
+
+/* Read `pattern`, whose last symbol opens a block of kind `opens` (-1 if
+ * it opens none; the caller pushes it) */
+static int parse_pattern(Parser *p, const char *pattern, int opens, int *expr, Token *last) {
+    p->pattern = pattern;
+    p->step = 0;
+    p->opens = opens;
+    return continue_pattern(p, 0, expr, last);
+}
+
+/*
+ * Skip the rest of a statement the grammar does not know, through its
+ * ';'. Returns 0 after an unexpected EOF or '}' that was not repaired.
+ */
+static int skip_statement(Parser *p) {
+    Token token;
 
-    /* Parse stmt_list (possibly empty) and the closing '}' */
+    p->skipping = 1;
     for (;;) {
+        token = next_token(p);
+        if (token.type == TOKEN_SYMBOL && strcmp(token.lexeme, ";") == 0) {
+            return 1;
+        }
+
+        if (p->quiet && (token.type == TOKEN_EOF ||
+                         (token.type == TOKEN_SYMBOL && strcmp(token.lexeme, "}") == 0))) {
+            p->failed = 1;
+            return 0;
+        }
+
+        if (token.type == TOKEN_EOF) {
+            printf("Syntax error: unexpected EOF in statement at line %d, column %d "
+                   "(expected ';' or '}')\n",
+                   token.line,
+                   token.column);
+            error_tracker_log(E_UNTERMINATED_STMT, &token);
+            if (threshold_check(E_UNTERMINATED_STMT, &token)) {
+                printf("Notice: This appears to be a repeated (habitual) mistake.\n");
+            }
+            highlight_error(E_UNTERMINATED_STMT, &token);
+            return 0;
+        }
+
+        if (token.type == TOKEN_SYMBOL && strcmp(token.lexeme, "}") == 0) {
+            printf("Syntax error: unexpected '}' in statement at line %d, column %d "
+                   "(missing ';' before closing brace)\n",
+                   token.line,
+                   token.column);
+            error_tracker_log(E_MISSING_SEMICOLON, &token);
+            int is_habit_detected = threshold_check(E_MISSING_SEMICOLON, &token);
+            if (is_habit_detected) {
+                printf("Notice: This appears to be a repeated (habitual) mistake.\n");
+                if (try_repair(p, E_MISSING_SEMICOLON, &token) == AUTOFIX_APPLIED) {
+                    highlight_error(E_MISSING_SEMICOLON, &token);
+                    continue;
+                }
+            }
+            highlight_error(E_MISSING_SEMICOLON, &token);
+            return 0;
+        }
+    }
+}
+
+/* Finish the statement a repair trial starts in, from the copied state */
+static int resume_statement(Parser *p) {
+    Token last;
+    int expr;
+
+    if (p->skipping) {
+        return skip_statement(p);
+    }
+    if (p->pattern == NULL) {
+        return 1;
+    }
+    if (!continue_pattern(p, p->pattern[p->step] == 'e', &expr, &last)) {
+        return 0;
+    }
+    if (p->opens >= 0) {
+        push_block(p, (BlockKind)p->opens, -1, &last);
+    }
+    return 1;
+}
+
+/*
+ * Parse one function definition: int <name> ( ) { <stmt_list> }
+ * Returns 1 after consuming the function's closing '}', 0 on an error
+ * that could not be auto-fixed.
+ */
+static int parse_function(Parser *p) {
+    Token token;
+    int function;
+
+    p->block_depth = 0;
+    mark_statement(p);
+
+    /* Expect: int */
+    token = next_token(p);
+    if (!(token.type == TOKEN_KEYWORD && strcmp(token.lexeme, "int") == 0)) {
+        report_syntax_error(p, E_EXPECTED_INT, &token);
+        return 0;
+    }
+
+    /* Expect: main or another function name */
+    token = next_token(p);
+    if (!((token.type == TOKEN_KEYWORD && strcmp(token.lexeme, "main") == 0) ||
+          token.type == TOKEN_IDENTIFIER)) {
+        report_syntax_error(p, E_EXPECTED_FUNCTION_NAME, &token);
+        return 0;
+    }
+    function = ast_add_function(p->ast, token.lexeme, token.line, token.column);
+
+    /* Expect: ( ) { */
+    if (!parse_pattern(p, "(){", BLOCK_FUNCTION, NULL, &token)) {
+        return 0;
+    }
+
+    push_block(p, BLOCK_FUNCTION, -1, &token);
+    return parse_block_body(p, function);
+}
+
+/*
+ * Parse statements and nested blocks until the function block at the
+ * bottom of the block stack is closed. `function` is -1 for repair
+ * trials, whose blocks do not belong to any function in the AST.
+ */
+static int parse_block_body(Parser *p, int function) {
+    Token token;
+
+    /* Parse nested stmt_lists until the function's closing '}' */
+    for (;;) {
+        /* Between top-level statements no node is referenced from the
+         * block stack, so a streamed function can be handed off in pieces */
+        if (function >= 0 && p->tokens == NULL && parser_sink != NULL && p->block_depth == 1 &&
+            p->ast->stmt_count - p->ast->functions[function].body_start >= PARSE_STREAM_CHUNK) {
+            parser_sink(p->ast, function, 0, parser_sink_arg);
+            function = p->ast->function_count - 1; /* ast_drop_body() moves it to the front */
+        }
+
         /* Look at the next token to decide: '}' ends block, otherwise a stmt */
-        token = get_next_token();
+        mark_statement(p);
+        token = next_token(p);
 
-process_statement:
         if (token.type == TOKEN_EOF) {
+            const BlockFrame *open = &p->blocks[p->block_depth - 1];
+            Token open_brace;
+            int fixed = 0;
+
+            if (p->quiet) {
+                p->failed = 1;
+                return 0;
+            }
+
             printf("Syntax error: unexpected EOF inside block at line %d, column %d "
                    "(expected '}' or ';')\n",
                    token.line,
                    token.column);
-            error_tracker_log("syntax_error", "TOKEN_SYMBOL", "} or ;", &token);
-            if (threshold_check("syntax_error", "TOKEN_SYMBOL", "} or ;", &token)) {
+            printf("Note: unmatched '{' opened at line %d, column %d\n",
+                   open->line,
+                   open->column);
+            error_tracker_log(E_MISSING_BRACE, &token);
+            if (threshold_check(E_MISSING_BRACE, &token)) {
                 printf("Notice: This appears to be a repeated (habitual) mistake.\n");
+                fixed = try_repair(p, E_MISSING_BRACE, &token) == AUTOFIX_APPLIED;
+            }
+
+            /* Point the highlight at the brace that was never closed */
+            open_brace.type = TOKEN_SYMBOL;
+            strcpy(open_brace.lexeme, "{");
+            open_brace.line = open->line;
+            open_brace.column = open->column;
+            highlight_error(E_MISSING_BRACE, &open_brace);
+            if (fixed) {
+                continue;
             }
-            highlight_error("syntax_error", "TOKEN_SYMBOL", "} or ;", &token);
-            return;
+            return 0;
         }
 
-        /* End of block: no more statements */
+        /* End of block: close the innermost open body */
         if (token.type == TOKEN_SYMBOL && strcmp(token.lexeme, "}") == 0) {
-            break;
+            BlockFrame frame;
+
+            if (p->block_depth == 0) {
+                /* A repair trial closed every block it was given */
+                p->window_reached = 1;
+                return 0;
+            }
+            frame = p->blocks[--p->block_depth];
+
+            if (frame.kind == BLOCK_FUNCTION) {
+                if (function >= 0) {
+                    p->ast->functions[function].body_end = p->ast->stmt_count;
+                    if (p->tokens == NULL && parser_sink != NULL) {
+                        parser_sink(p->ast, function, 1, parser_sink_arg);
+                    }
+                }
+                return 1;
+            }
+
+            if (frame.kind == BLOCK_IF) {
+                Token after = next_token(p);
+                if (after.type == TOKEN_KEYWORD && strcmp(after.lexeme, "else") == 0) {
+                    Token lbrace_else;
+                    if (!parse_pattern(p, "{", BLOCK_ELSE, NULL, &lbrace_else)) {
+                        return 0;
+                    }
+
+                    int else_stmt = ast_add_stmt(p->ast, STMT_ELSE, after.line, after.column);
+                    if (frame.stmt >= 0) {
+                        p->ast->stmts[frame.stmt].else_branch = else_stmt;
+                    }
+                    push_block(p, BLOCK_ELSE, frame.stmt, &lbrace_else);
+                    continue;
+                }
+                push_back_token(p, &after);
+            } else if (frame.kind == BLOCK_ELSE && frame.stmt >= 0) {
+                int else_stmt = p->ast->stmts[frame.stmt].else_branch;
+                p->ast->stmts[else_stmt].end = p->ast->stmt_count;
+            }
+
+            /* if, else and while bodies all end here */
+            if (frame.stmt >= 0) {
+                p->ast->stmts[frame.stmt].end = p->ast->stmt_count;
+            }
+            continue;
         }
 
         /* Start of a statement */
         if (token.type == TOKEN_KEYWORD && strcmp(token.lexeme, "int") == 0) {
             /* Declaration statement: int <identifier> ; */
-            Token ident = get_next_token();
+            Token ident = next_token(p);
             if (ident.type != TOKEN_IDENTIFIER) {
-                report_syntax_error("TOKEN_IDENTIFIER", "<identifier>", &ident);
-                return;
+                report_syntax_error(p, E_EXPECTED_IDENTIFIER, &ident);
+                return 0;
             }
 
-            Token semi = get_next_token();
-            if (!(semi.type == TOKEN_SYMBOL && strcmp(semi.lexeme, ";") == 0)) {
-                if (report_syntax_error("TOKEN_SYMBOL", ";", &semi) == AUTOFIX_APPLIED) {
-                    token = semi;
-                    goto process_statement;
-                }
-                return;
+            int decl = ast_add_stmt(p->ast, STMT_DECL, ident.line, ident.column);
+            p->ast->stmts[decl].name = ast_add_name(p->ast, ident.lexeme);
+
+            if (!parse_pattern(p, ";", -1, NULL, NULL)) {
+                return 0;
             }
 
             /* Valid declaration statement consumed; continue with next statement or '}' */
@@ -148,195 +940,331 @@ process_statement:
         }
 
         if (token.type == TOKEN_KEYWORD && strcmp(token.lexeme, "if") == 0) {
-            /* If statement: if ( IDENTIFIER | NUMBER ) { } */
-            Token lparen_if = get_next_token();
-            if (!(lparen_if.type == TOKEN_SYMBOL && strcmp(lparen_if.lexeme, "(") == 0)) {
-                report_syntax_error("TOKEN_SYMBOL", "(", &lparen_if);
-                return;
-            }
-
-            Token cond = get_next_token();
-            if (!(cond.type == TOKEN_IDENTIFIER || cond.type == TOKEN_NUMBER)) {
-                report_syntax_error("TOKEN_IDENTIFIER or TOKEN_NUMBER",
-                                    "<identifier or number>",
-                                    &cond);
-                return;
-            }
+            /* If statement: if ( <expression> ) { <stmt_list> } [ else { <stmt_list> } ] */
+            Token lbrace_if;
+            int cond;
 
-            Token rparen_if = get_next_token();
-            if (!(rparen_if.type == TOKEN_SYMBOL && strcmp(rparen_if.lexeme, ")") == 0)) {
-                report_syntax_error("TOKEN_SYMBOL", ")", &rparen_if);
-                return;
+            if (!parse_pattern(p, "(e){", BLOCK_IF, &cond, &lbrace_if)) {
+                return 0;
             }
 
-            Token lbrace_if = get_next_token();
-            if (!(lbrace_if.type == TOKEN_SYMBOL && strcmp(lbrace_if.lexeme, "{") == 0)) {
-                report_syntax_error("TOKEN_SYMBOL", "{", &lbrace_if);
-                return;
-            }
+            int if_stmt = ast_add_stmt(p->ast, STMT_IF, token.line, token.column);
+            p->ast->stmts[if_stmt].expr = cond;
 
-            Token rbrace_if = get_next_token();
-            if (!(rbrace_if.type == TOKEN_SYMBOL && strcmp(rbrace_if.lexeme, "}") == 0)) {
-                report_syntax_error("TOKEN_SYMBOL", "}", &rbrace_if);
-                return;
-            }
-
-            /* Valid if statement consumed; continue with next statement or '}' */
+            /* Body statements follow until the matching '}' */
+            push_block(p, BLOCK_IF, if_stmt, &lbrace_if);
             continue;
         }
 
         if (token.type == TOKEN_KEYWORD && strcmp(token.lexeme, "while") == 0) {
-            /* While statement: while ( IDENTIFIER | NUMBER ) { } */
-            Token lparen_while = get_next_token();
-            if (!(lparen_while.type == TOKEN_SYMBOL && strcmp(lparen_while.lexeme, "(") == 0)) {
-                report_syntax_error("TOKEN_SYMBOL", "(", &lparen_while);
-                return;
-            }
+            /* While statement: while ( <expression> ) { <stmt_list> } */
+            Token lbrace_while;
+            int cond_while;
 
-            Token cond_while = get_next_token();
-            if (!(cond_while.type == TOKEN_IDENTIFIER || cond_while.type == TOKEN_NUMBER)) {
-                report_syntax_error("TOKEN_IDENTIFIER or TOKEN_NUMBER",
-                                    "<identifier or number>",
-                                    &cond_while);
-                return;
+            if (!parse_pattern(p, "(e){", BLOCK_WHILE, &cond_while, &lbrace_while)) {
+                return 0;
             }
 
-            Token rparen_while = get_next_token();
-            if (!(rparen_while.type == TOKEN_SYMBOL && strcmp(rparen_while.lexeme, ")") == 0)) {
-                report_syntax_error("TOKEN_SYMBOL", ")", &rparen_while);
-                return;
-            }
-
-            Token lbrace_while = get_next_token();
-            if (!(lbrace_while.type == TOKEN_SYMBOL && strcmp(lbrace_while.lexeme, "{") == 0)) {
-                report_syntax_error("TOKEN_SYMBOL", "{", &lbrace_while);
-                return;
-            }
-
-            Token rbrace_while = get_next_token();
-            if (!(rbrace_while.type == TOKEN_SYMBOL && strcmp(rbrace_while.lexeme, "}") == 0)) {
-                report_syntax_error("TOKEN_SYMBOL", "}", &rbrace_while);
-                return;
-            }
+            int while_stmt = ast_add_stmt(p->ast, STMT_WHILE, token.line, token.column);
+            p->ast->stmts[while_stmt].expr = cond_while;
 
-            /* Valid while statement consumed; continue with next statement or '}' */
+            /* Body statements follow until the matching '}' */
+            push_block(p, BLOCK_WHILE, while_stmt, &lbrace_while);
             continue;
         }
 
         if (token.type == TOKEN_KEYWORD && strcmp(token.lexeme, "print") == 0) {
-            /* Print statement: print ( IDENTIFIER | NUMBER ) ; */
-            Token lparen = get_next_token();
-            if (!(lparen.type == TOKEN_SYMBOL && strcmp(lparen.lexeme, "(") == 0)) {
-                report_syntax_error("TOKEN_SYMBOL", "(", &lparen);
-                return;
-            }
-
-            Token value = get_next_token();
-            if (!(value.type == TOKEN_IDENTIFIER || value.type == TOKEN_NUMBER)) {
-                report_syntax_error("TOKEN_IDENTIFIER or TOKEN_NUMBER",
-                                    "<identifier or number>",
-                                    &value);
-                return;
-            }
+            /* Print statement: print ( <expression> ) ; */
+            int value;
 
-            Token rparen = get_next_token();
-            if (!(rparen.type == TOKEN_SYMBOL && strcmp(rparen.lexeme, ")") == 0)) {
-                report_syntax_error("TOKEN_SYMBOL", ")", &rparen);
-                return;
+            if (!parse_pattern(p, "(e);", -1, &value, NULL)) {
+                return 0;
             }
 
-            Token semi_print = get_next_token();
-            if (!(semi_print.type == TOKEN_SYMBOL && strcmp(semi_print.lexeme, ";") == 0)) {
-                if (report_syntax_error("TOKEN_SYMBOL", ";", &semi_print) == AUTOFIX_APPLIED) {
-                    token = semi_print;
-                    goto process_statement;
-                }
-                return;
-            }
+            int print_stmt = ast_add_stmt(p->ast, STMT_PRINT, token.line, token.column);
+            p->ast->stmts[print_stmt].expr = value;
 
             /* Valid print statement consumed; continue with next statement or '}' */
             continue;
         }
 
         if (token.type == TOKEN_IDENTIFIER) {
-            /* Assignment statement: <identifier> = <number> ; */
-            Token eq = get_next_token();
-            if (!(eq.type == TOKEN_SYMBOL && strcmp(eq.lexeme, "=") == 0)) {
-                report_syntax_error("TOKEN_SYMBOL", "=", &eq);
-                return;
-            }
+            /* Assignment statement: <identifier> = <expression> ; */
+            int value;
 
-            Token number = get_next_token();
-            if (number.type != TOKEN_NUMBER) {
-                report_syntax_error("TOKEN_NUMBER", "<number>", &number);
-                return;
+            if (!parse_pattern(p, "=e;", -1, &value, NULL)) {
+                return 0;
             }
 
-            Token semi2 = get_next_token();
-            if (!(semi2.type == TOKEN_SYMBOL && strcmp(semi2.lexeme, ";") == 0)) {
-                if (report_syntax_error("TOKEN_SYMBOL", ";", &semi2) == AUTOFIX_APPLIED) {
-                    token = semi2;
-                    goto process_statement;
-                }
-                return;
-            }
+            int assign = ast_add_stmt(p->ast, STMT_ASSIGN, token.line, token.column);
+            p->ast->stmts[assign].name = ast_add_name(p->ast, token.lexeme);
+            p->ast->stmts[assign].expr = value;
 
             /* Valid assignment statement consumed; continue with next statement or '}' */
             continue;
         }
 
         /* Non-declaration, non-assignment statement: consume tokens until we find ';' */
-        while (!(token.type == TOKEN_SYMBOL && strcmp(token.lexeme, ";") == 0)) {
-            token = get_next_token();
-
-            if (token.type == TOKEN_EOF) {
-                printf("Syntax error: unexpected EOF in statement at line %d, column %d "
-                       "(expected ';' or '}')\n",
-                       token.line,
-                       token.column);
-                error_tracker_log("syntax_error", "TOKEN_SYMBOL", "; or }", &token);
-                if (threshold_check("syntax_error", "TOKEN_SYMBOL", "; or }", &token)) {
-                    printf("Notice: This appears to be a repeated (habitual) mistake.\n");
-                }
-                highlight_error("syntax_error", "TOKEN_SYMBOL", "; or }", &token);
-                return;
+        if (p->strict_from >= 0 && p->token_pos >= p->strict_from) {
+            /* Skipping it would let any repair look good */
+            p->failed = 1;
+            return 0;
+        }
+        if (!(token.type == TOKEN_SYMBOL && strcmp(token.lexeme, ";") == 0) && !skip_statement(p)) {
+            return 0;
+        }
+        /* ';' consumed: one non-declaration statement completed; continue to look for more or '}' */
+    }
+}
+
+/* Parse further functions until the end of input */
+static int parse_remaining_functions(Parser *p) {
+    for (;;) {
+        Token token = next_token(p);
+        push_back_token(p, &token);
+        if (token.type == TOKEN_EOF) {
+            return 1;
+        }
+        if (!parse_function(p)) {
+            return 0;
+        }
+    }
+}
+
+int parse_program(void) {
+    Parser *p = &main_parser;
+
+    p->tokens = NULL;
+    if (!parse_function(p) || !parse_remaining_functions(p)) {
+        return 0;
+    }
+
+    printf("Program with statements parsed successfully\n");
+    return 1;
+}
+
+/* ---- Parallel parsing of function bodies ---- */
+
+/* Below this many tokens thread start-up costs more than it saves */
+#define PARALLEL_MIN_TOKENS 16384
+
+typedef struct {
+    int start;            /* first token of the function ('int') */
+    int end;              /* one past its closing '}' */
+    Ast ast;              /* arena owned by whichever worker parsed it */
+    int ok;
+} FunctionJob;
+
+typedef struct {
+    const TokenArray *array;
+    FunctionJob *jobs;
+    int job_count;
+    int next_job;
+    pthread_mutex_t lock;
+} JobQueue;
+
+static int hardware_threads(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+/*
+ * Split the token array into top-level functions by matching braces,
+ * without parsing statements. Stops at the first token that does not
+ * start a well-formed `int <name> ( ) { ... }`; the index of that token
+ * is returned so the rest can be parsed (and diagnosed) sequentially.
+ */
+static int prescan_functions(const TokenArray *array, FunctionJob **jobs, int *job_count) {
+    const PackedToken *t = array->tokens;
+    int count = array->count;
+    int capacity = 0;
+    int pos = 0;
+
+    *jobs = NULL;
+    *job_count = 0;
+
+    while (pos + 4 < count &&
+           t[pos].type == TOKEN_KEYWORD && strcmp(token_array_lexeme(array, pos), "int") == 0 &&
+           (t[pos + 1].type == TOKEN_IDENTIFIER ||
+            (t[pos + 1].type == TOKEN_KEYWORD &&
+             strcmp(token_array_lexeme(array, pos + 1), "main") == 0)) &&
+           t[pos + 2].type == TOKEN_SYMBOL && strcmp(token_array_lexeme(array, pos + 2), "(") == 0 &&
+           t[pos + 3].type == TOKEN_SYMBOL && strcmp(token_array_lexeme(array, pos + 3), ")") == 0 &&
+           t[pos + 4].type == TOKEN_SYMBOL && strcmp(token_array_lexeme(array, pos + 4), "{") == 0) {
+        int depth = 0;
+        int i;
+
+        for (i = pos + 4; i < count && t[i].type != TOKEN_EOF; i++) {
+            const char *lexeme;
+
+            if (t[i].type != TOKEN_SYMBOL) {
+                continue;
+            }
+            lexeme = token_array_lexeme(array, i);
+            if (lexeme[1] != '\0') {
+                continue;
             }
+            if (lexeme[0] == '{') {
+                depth++;
+            } else if (lexeme[0] == '}' && --depth == 0) {
+                break;
+            }
+        }
+        if (depth != 0) {
+            break; /* unbalanced: leave it to the sequential parser */
+        }
 
-            if (token.type == TOKEN_SYMBOL && strcmp(token.lexeme, "}") == 0) {
-                printf("Syntax error: unexpected '}' in statement at line %d, column %d "
-                       "(missing ';' before closing brace)\n",
-                       token.line,
-                       token.column);
-                error_tracker_log("syntax_error", "TOKEN_SYMBOL", ";", &token);
-                int is_habit_detected = threshold_check("syntax_error", "TOKEN_SYMBOL", ";", &token);
-                if (is_habit_detected) {
-                    printf("Notice: This appears to be a repeated (habitual) mistake.\n");
-                    if (is_safe_autofix_error(";", token.lexeme)) {
-                        if (autofix_already_applied_on_line(token.line)) {
-                            printf("Auto-fix already applied on this line. Skipping.\n");
-                        } else if (autofix_limit_reached()) {
-                            printf("Auto-fix limit reached. Further errors require manual correction.\n");
-                        } else if (autofix_try("syntax_error", "TOKEN_SYMBOL", ";", &token) == AUTOFIX_APPLIED) {
-                            autofix_record_applied();
-                            autofix_record_line(token.line);
-                            printf("Auto-fix applied (execution-only): missing ';'\n");
-                            printf("Warning: This error was automatically corrected for execution only. Please fix it in your source code.\n");
-                            highlight_error("syntax_error", "TOKEN_SYMBOL", ";", &token);
-                            goto process_statement;
-                        }
-                    }
-                }
-                highlight_error("syntax_error", "TOKEN_SYMBOL", ";", &token);
-                return;
+        if (*job_count == capacity) {
+            *jobs = grow_stack(*jobs, &capacity, sizeof(FunctionJob));
+        }
+        (*jobs)[*job_count].start = pos;
+        (*jobs)[*job_count].end = i + 1;
+        (*jobs)[*job_count].ok = 0;
+        ast_init(&(*jobs)[*job_count].ast);
+        (*job_count)++;
+        pos = i + 1;
+    }
+
+    return pos;
+}
+
+static void *parse_worker(void *arg) {
+    JobQueue *queue = arg;
+    Parser parser;
+
+    for (;;) {
+        FunctionJob *job;
+        int index;
+
+        pthread_mutex_lock(&queue->lock);
+        index = queue->next_job++;
+        pthread_mutex_unlock(&queue->lock);
+        if (index >= queue->job_count) {
+            break;
+        }
+
+        job = &queue->jobs[index];
+        parser_state_init(&parser, NULL, &job->ast);
+        parser.tokens = queue->array;
+        parser.pos = job->start;
+        parser.end = job->end;
+        parser.quiet = 1;
+        job->ok = parse_function(&parser) && !parser.failed && parser.pos == job->end;
+        parser_state_free(&parser);
+    }
+
+    return NULL;
+}
+
+/*
+ * Parse every prescanned function on worker threads, then merge the
+ * results in source order. The first function that fails its quiet parse
+ * is parsed again on the main parser with full diagnostics and auto-fix,
+ * exactly as a sequential parse would have done, so output and habit
+ * history do not depend on thread scheduling.
+ */
+static int parse_jobs_parallel(Parser *p, const TokenArray *array,
+                               FunctionJob *jobs, int job_count, int threads,
+                               int *finished) {
+    JobQueue queue;
+    pthread_t *workers;
+    int started = 0;
+    int ok = 1;
+    int i;
+
+    queue.array = array;
+    queue.jobs = jobs;
+    queue.job_count = job_count;
+    queue.next_job = 0;
+    pthread_mutex_init(&queue.lock, NULL);
+
+    workers = malloc((size_t)threads * sizeof(pthread_t));
+    if (workers != NULL) {
+        for (i = 0; i < threads; i++) {
+            if (pthread_create(&workers[started], NULL, parse_worker, &queue) == 0) {
+                started++;
             }
         }
-        /* ';' consumed: one non-declaration statement completed; continue to look for more or '}' */
     }
+    if (started == 0) {
+        parse_worker(&queue); /* no threads available: do the work here */
+    }
+    for (i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+    pthread_mutex_destroy(&queue.lock);
 
-    printf("Program with statements parsed successfully\n");
+    for (i = 0; i < job_count; i++) {
+        if (jobs[i].ok) {
+            ast_append(p->ast, &jobs[i].ast);
+            continue;
+        }
+
+        seek_token(p, jobs[i].start);
+        if (!parse_function(p)) {
+            ok = 0;
+            break;
+        }
+        if (p->pos != jobs[i].end) {
+            /* A fix moved the function boundary; finish sequentially */
+            ok = parse_remaining_functions(p);
+            *finished = 1;
+            break;
+        }
+    }
+
+    return ok;
 }
 
-void parser_close(void) {
-    /* No parser resources to release yet */
+int parse_program_tokens(const TokenArray *array) {
+    Parser *p = &main_parser;
+    FunctionJob *jobs;
+    int job_count;
+    int rest;
+    int threads = parser_threads > 0 ? parser_threads : hardware_threads();
+    int ok;
+    int i;
+
+    p->tokens = array;
+    p->pos = 0;
+    p->end = array->count;
+    p->has_pending = 0;
+
+    rest = prescan_functions(array, &jobs, &job_count);
+    if (threads > job_count) {
+        threads = job_count;
+    }
+
+    if (job_count < 2 || threads < 2 || array->count < PARALLEL_MIN_TOKENS) {
+        ok = parse_function(p) && parse_remaining_functions(p);
+    } else {
+        int finished = 0;
+        ok = parse_jobs_parallel(p, array, jobs, job_count, threads, &finished);
+        if (ok && !finished) {
+            /* Whatever the prescan could not split is parsed in order */
+            seek_token(p, rest);
+            ok = parse_remaining_functions(p);
+        }
+    }
+
+    for (i = 0; i < job_count; i++) {
+        ast_free(&jobs[i].ast);
+    }
+    free(jobs);
+
+    if (ok) {
+        printf("Program with statements parsed successfully\n");
+    }
+    return ok;
 }
 
+void parser_close(void) {
+    parser_state_free(&main_parser);
+}
@@ -0,0 +1,586 @@
+// Per-user habit profiles with an LRU cache
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#include <direct.h>
+#define make_dir(path) _mkdir(path)
+#define remove_dir(path) _rmdir(path)
+#else
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define make_dir(path) mkdir(path, 0777)
+#define remove_dir(path) rmdir(path)
+#endif
+
+#include "config.h"
+#include "lexer.h"
+#include "error_tracker.h"
+#include "habit_index.h"
+#include "habit_sketch.h"
+#include "profile_store.h"
+
+#define DIR_BUFFER (32 + 3 * PROFILE_ID_MAX)    /* data/users/xx/yy/ + escaped id */
+#define PATH_BUFFER (DIR_BUFFER + 32)
+#define RECORD_MAX 512
+
+static const char *const file_names[] = {
+    "user_profile.dat",
+    "user_profile.idx",
+    "user_profile.cms"
+};
+
+typedef struct {
+    char user[PROFILE_ID_MAX + 1];
+    unsigned int hash;
+    char dir[DIR_BUFFER];
+    char paths[3][PATH_BUFFER];
+
+    /* Exact counts, loaded by the first profile_count() */
+    int loaded;
+    HabitIndex index;         /* per logged record, saved as PROFILE_INDEX */
+    Tally fingerprints;       /* per mistake, as the threshold counts it */
+    long saved_offset;        /* index.log_offset of the saved index */
+
+    char *pending;            /* log lines not yet written back */
+    size_t pending_len;
+    size_t pending_capacity;
+
+    int prev;                 /* LRU neighbours, -1 at either end */
+    int next;
+} ProfileEntry;
+
+static ProfileEntry *entries = NULL;
+static int entry_count = 0;
+static int *slots = NULL;     /* open-addressing index: entry or -1 */
+static unsigned int slot_mask = 0;
+static int lru_head = -1;     /* most recently selected */
+static int lru_tail = -1;
+static int current = -1;
+
+/* FNV-1a */
+static unsigned int hash_id(const char *id) {
+    unsigned int hash = 2166136261u;
+    while (*id != '\0') {
+        hash ^= (unsigned char)*id++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void init_store(void) {
+    unsigned int capacity = 4;
+    unsigned int i;
+
+    if (entries != NULL) {
+        return;
+    }
+    while (capacity < 2u * PROFILE_CACHE_SIZE) {
+        capacity *= 2;
+    }
+    entries = calloc(PROFILE_CACHE_SIZE, sizeof(ProfileEntry));
+    slots = malloc(capacity * sizeof(int));
+    if (entries == NULL || slots == NULL) {
+        fprintf(stderr, "Error: Out of memory while loading habit profiles\n");
+        exit(1);
+    }
+    for (i = 0; i < capacity; i++) {
+        slots[i] = -1;
+    }
+    slot_mask = capacity - 1;
+    atexit(profile_store_close);
+}
+
+/* ---- Cache index and LRU list ---- */
+
+static int index_find(const char *user, unsigned int hash) {
+    unsigned int i = hash & slot_mask;
+
+    while (slots[i] >= 0) {
+        const ProfileEntry *entry = &entries[slots[i]];
+        if (entry->hash == hash && strcmp(entry->user, user) == 0) {
+            return slots[i];
+        }
+        i = (i + 1) & slot_mask;
+    }
+    return -1;
+}
+
+static void index_insert(int entry) {
+    unsigned int i = entries[entry].hash & slot_mask;
+
+    while (slots[i] >= 0) {
+        i = (i + 1) & slot_mask;
+    }
+    slots[i] = entry;
+}
+
+/* Backward-shift deletion keeps probe chains intact without tombstones */
+static void index_remove(int entry) {
+    unsigned int i = entries[entry].hash & slot_mask;
+    unsigned int j;
+
+    while (slots[i] != entry) {
+        i = (i + 1) & slot_mask;
+    }
+    slots[i] = -1;
+    for (j = (i + 1) & slot_mask; slots[j] >= 0; j = (j + 1) & slot_mask) {
+        unsigned int home = entries[slots[j]].hash & slot_mask;
+        int stays = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+
+        if (!stays) {
+            slots[i] = slots[j];
+            slots[j] = -1;
+            i = j;
+        }
+    }
+}
+
+static void lru_unlink(int entry) {
+    ProfileEntry *e = &entries[entry];
+
+    if (e->prev >= 0) {
+        entries[e->prev].next = e->next;
+    } else {
+        lru_head = e->next;
+    }
+    if (e->next >= 0) {
+        entries[e->next].prev = e->prev;
+    } else {
+        lru_tail = e->prev;
+    }
+}
+
+static void lru_push_front(int entry) {
+    entries[entry].prev = -1;
+    entries[entry].next = lru_head;
+    if (lru_head >= 0) {
+        entries[lru_head].prev = entry;
+    }
+    lru_head = entry;
+    if (lru_tail < 0) {
+        lru_tail = entry;
+    }
+}
+
+/* ---- Counts ---- */
+
+static void count_fingerprint(void *arg, const ErrorRecord *record, unsigned long amount) {
+    ProfileEntry *entry = arg;
+    char key[RECORD_MAX];
+
+    snprintf(key, sizeof(key), "%d|%d|%d|%d|%s", (int)record->code, (int)record->actual_type,
+             record->line, record->column, record->actual_lexeme);
+    tally_add(&entry->fingerprints, key, amount);
+}
+
+/* Count one formatted log line (`len` bytes, no newline) */
+static void count_line(ProfileEntry *entry, const char *line, size_t len) {
+    char copy[RECORD_MAX];
+    ErrorRecord record;
+
+    if (len >= sizeof(copy)) {
+        return; /* too long for the log reader as well */
+    }
+    memcpy(copy, line, len);
+    copy[len] = '\0';
+    if (error_record_parse(copy, &record)) {
+        habit_index_add(&entry->index, &record, 1);
+        count_fingerprint(entry, &record, 1);
+    }
+}
+
+static void clear_counts(ProfileEntry *entry) {
+    habit_index_free(&entry->index);
+    tally_free(&entry->fingerprints);
+    habit_index_init(&entry->index);
+    tally_init(&entry->fingerprints);
+    entry->saved_offset = 0;
+}
+
+/* Count every complete line of an open log past index.log_offset */
+static void fold_open_log(ProfileEntry *entry, FILE *log) {
+    if (fseek(log, 0, SEEK_END) == 0 && ftell(log) < entry->index.log_offset) {
+        clear_counts(entry); /* the log was reset */
+    }
+    habit_index_read_log(&entry->index, log, count_fingerprint, entry);
+}
+
+static void fold_log(ProfileEntry *entry) {
+    FILE *log;
+
+    if (!entry->loaded) {
+        return; /* counted from scratch when first needed */
+    }
+    log = fopen(entry->paths[PROFILE_LOG], "rb");
+    if (log == NULL) {
+        if (entry->index.log_offset > 0) {
+            clear_counts(entry); /* the log was reset */
+        }
+        return;
+    }
+    fold_open_log(entry, log);
+    fclose(log);
+}
+
+/* Persist the counts, which must not include pending records, so the next
+ * miss on this profile starts from them instead of the whole log. Saving
+ * costs a line per distinct mistake, so a short tail is left for the next
+ * load to read. */
+static void save_counts(ProfileEntry *entry) {
+    if (entry->loaded &&
+        entry->index.log_offset - entry->saved_offset >= PROFILE_INDEX_TAIL_BYTES) {
+        habit_index_save(&entry->index, entry->paths[PROFILE_INDEX]);
+        entry->saved_offset = entry->index.log_offset;
+    }
+}
+
+/* Counts start from the saved index, so only the log written since it was
+ * saved is read; records still pending are added on top */
+static void load_counts(ProfileEntry *entry) {
+    FILE *log = fopen(entry->paths[PROFILE_LOG], "rb");
+    long log_size = 0;
+    size_t start;
+    size_t i;
+
+    if (log != NULL && fseek(log, 0, SEEK_END) == 0) {
+        log_size = ftell(log);
+    }
+    entry->loaded = 1;
+    entry->saved_offset = 0;
+    if (habit_index_load(&entry->index, entry->paths[PROFILE_INDEX], log_size,
+                         count_fingerprint, entry)) {
+        entry->saved_offset = entry->index.log_offset;
+    }
+    if (log != NULL) {
+        habit_index_read_log(&entry->index, log, count_fingerprint, entry);
+        fclose(log);
+    }
+    save_counts(entry);
+
+    for (start = 0, i = 0; i < entry->pending_len; i++) {
+        if (entry->pending[i] == '\n') {
+            count_line(entry, entry->pending + start, i - start);
+            start = i + 1;
+        }
+    }
+}
+
+static int make_profile_dir(const ProfileEntry *entry);
+
+/* Other writers hold the log's lock for their whole append, so an
+ * unterminated last line found under it was left by a crashed one */
+static void terminate_log(FILE *log) {
+    long size;
+
+    if (fseek(log, 0, SEEK_END) != 0 || (size = ftell(log)) <= 0 ||
+        fseek(log, size - 1, SEEK_SET) != 0) {
+        return;
+    }
+    if (fgetc(log) != '\n') {
+        fseek(log, 0, SEEK_END);
+        fputc('\n', log);
+        fflush(log);
+    }
+}
+
+static void flush_entry(ProfileEntry *entry) {
+    FILE *log = NULL;
+
+    if (entry->pending_len == 0) {
+        return;
+    }
+    if (make_profile_dir(entry) == 0) {
+        log = fopen(entry->paths[PROFILE_LOG], "a+b");
+    }
+    if (log == NULL) {
+        fold_log(entry); /* the log may have been removed */
+        entry->pending_len = 0; /* without a data/ directory the records are dropped */
+        return;
+    }
+
+    /* Locked from the fold to the end of the append, so no record another
+     * process writes can fall between the counted log and our own */
+    profile_lock_file(log, 1);
+    terminate_log(log);
+    if (entry->loaded) {
+        fold_open_log(entry, log); /* records other processes added since we last looked */
+    }
+    if (fseek(log, 0, SEEK_END) == 0 &&
+        fwrite(entry->pending, 1, entry->pending_len, log) == entry->pending_len &&
+        fflush(log) == 0 && entry->loaded) {
+        entry->index.log_offset = ftell(log);
+    }
+    profile_unlock_file(log);
+    fclose(log);
+    entry->pending_len = 0;
+}
+
+static void free_entry(ProfileEntry *entry) {
+    habit_index_free(&entry->index);
+    tally_free(&entry->fingerprints);
+    free(entry->pending);
+    entry->pending = NULL;
+    entry->pending_len = 0;
+    entry->pending_capacity = 0;
+}
+
+/* ---- File locks ---- */
+
+void profile_lock_file(FILE *file, int exclusive) {
+#ifdef _WIN32
+    OVERLAPPED where;
+    memset(&where, 0, sizeof(where));
+    LockFileEx((HANDLE)_get_osfhandle(_fileno(file)), exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0,
+               0, MAXDWORD, MAXDWORD, &where);
+#else
+    flock(fileno(file), exclusive ? LOCK_EX : LOCK_SH);
+#endif
+}
+
+void profile_unlock_file(FILE *file) {
+    fflush(file);
+#ifdef _WIN32
+    {
+        OVERLAPPED where;
+        memset(&where, 0, sizeof(where));
+        UnlockFileEx((HANDLE)_get_osfhandle(_fileno(file)), 0, MAXDWORD, MAXDWORD, &where);
+    }
+#else
+    flock(fileno(file), LOCK_UN);
+#endif
+}
+
+/* ---- Paths ---- */
+
+static void build_paths(ProfileEntry *entry) {
+    int i;
+
+    if (entry->user[0] == '\0') {
+        snprintf(entry->dir, sizeof(entry->dir), "%s", PROFILE_DATA_DIR);
+    } else {
+        char encoded[PROFILE_ID_MAX * 3 + 1];
+        const char *in;
+        char *out = encoded;
+
+        for (in = entry->user; *in != '\0'; in++) {
+            unsigned char c = (unsigned char)*in;
+            int plain = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                        (c >= '0' && c <= '9') || c == '_' || c == '-' ||
+                        (c == '.' && in != entry->user);
+            if (plain) {
+                *out++ = (char)c;
+            } else {
+                out += sprintf(out, "%%%02X", c);
+            }
+        }
+        *out = '\0';
+        snprintf(entry->dir, sizeof(entry->dir), "%s/users/%02x/%02x/%s", PROFILE_DATA_DIR,
+                 entry->hash & 0xffu, (entry->hash >> 8) & 0xffu, encoded);
+    }
+    for (i = 0; i < 3; i++) {
+        snprintf(entry->paths[i], sizeof(entry->paths[i]), "%s/%s", entry->dir, file_names[i]);
+    }
+}
+
+/* data/users/xx/yy/id, one level at a time below an existing data/ */
+static int make_profile_dir(const ProfileEntry *entry) {
+    char path[PATH_BUFFER];
+    char *slash;
+
+    if (entry->user[0] == '\0') {
+        return 0; /* data/ itself is never created for the default profile */
+    }
+    snprintf(path, sizeof(path), "%s", entry->dir);
+    for (slash = path + strlen(PROFILE_DATA_DIR) + 1; (slash = strchr(slash, '/')) != NULL; slash++) {
+        *slash = '\0';
+        if (make_dir(path) != 0 && errno != EEXIST) {
+            return 1;
+        }
+        *slash = '/';
+    }
+    if (make_dir(path) != 0 && errno != EEXIST) {
+        return 1;
+    }
+    return 0;
+}
+
+int profile_prepare_dir(void) {
+    if (current < 0) {
+        profile_select(NULL);
+    }
+    return make_profile_dir(&entries[current]);
+}
+
+/* ---- Public interface ---- */
+
+int profile_select(const char *user_id) {
+    unsigned int hash;
+    int entry;
+
+    if (user_id == NULL) {
+        user_id = "";
+    }
+    if (strlen(user_id) > PROFILE_ID_MAX) {
+        return 1;
+    }
+    init_store();
+
+    if (current >= 0 && strcmp(entries[current].user, user_id) == 0) {
+        fold_log(&entries[current]);
+        return 0;
+    }
+
+    hash = hash_id(user_id);
+    entry = index_find(user_id, hash);
+    if (entry >= 0) {
+        lru_unlink(entry);
+    } else {
+        if (entry_count < PROFILE_CACHE_SIZE) {
+            entry = entry_count++;
+        } else {
+            /* Evict the least recently selected profile */
+            entry = lru_tail;
+            flush_entry(&entries[entry]);
+            save_counts(&entries[entry]);
+            lru_unlink(entry);
+            index_remove(entry);
+            free_entry(&entries[entry]);
+        }
+        memset(&entries[entry], 0, sizeof(ProfileEntry));
+        strcpy(entries[entry].user, user_id);
+        entries[entry].hash = hash;
+        habit_index_init(&entries[entry].index);
+        tally_init(&entries[entry].fingerprints);
+        build_paths(&entries[entry]);
+        index_insert(entry);
+    }
+    lru_push_front(entry);
+    current = entry;
+
+    fold_log(&entries[entry]);
+    habit_sketch_retarget();
+    return 0;
+}
+
+const char *profile_current_user(void) {
+    return current >= 0 ? entries[current].user : "";
+}
+
+const char *profile_path(ProfileFile which) {
+    if (current < 0) {
+        profile_select(NULL);
+    }
+    return entries[current].paths[which];
+}
+
+void profile_append(const char *record_line) {
+    ProfileEntry *entry;
+    size_t len = strlen(record_line);
+
+    if (current < 0) {
+        profile_select(NULL);
+    }
+    entry = &entries[current];
+
+    if (entry->pending_len + len + 1 > entry->pending_capacity) {
+        size_t new_capacity = entry->pending_capacity ? entry->pending_capacity * 2 : 1024;
+        char *grown;
+
+        while (new_capacity < entry->pending_len + len + 1) {
+            new_capacity *= 2;
+        }
+        grown = realloc(entry->pending, new_capacity);
+        if (grown == NULL) {
+            fprintf(stderr, "Error: Out of memory while logging errors\n");
+            exit(1);
+        }
+        entry->pending = grown;
+        entry->pending_capacity = new_capacity;
+    }
+    memcpy(entry->pending + entry->pending_len, record_line, len);
+    entry->pending_len += len;
+    entry->pending[entry->pending_len++] = '\n';
+
+    if (entry->loaded) {
+        count_line(entry, record_line, len);
+    }
+    if (entry->pending_len >= PROFILE_WRITEBACK_BYTES) {
+        flush_entry(entry);
+    }
+}
+
+unsigned long profile_count(ErrorCode code, const Token *token) {
+    char key[RECORD_MAX];
+    ProfileEntry *entry;
+
+    if (current < 0) {
+        profile_select(NULL);
+    }
+    entry = &entries[current];
+    if (!entry->loaded) {
+        load_counts(entry);
+    }
+    snprintf(key, sizeof(key), "%d|%d|%d|%d|%s", (int)code, (int)token->type, token->line,
+             token->column, token->lexeme);
+    /* A check follows the append of the same mistake, so this normally
+     * finds the key rather than adding it */
+    return tally_count(&entry->fingerprints, key);
+}
+
+void profile_store_flush(void) {
+    int entry;
+
+    for (entry = lru_head; entry >= 0; entry = entries[entry].next) {
+        flush_entry(&entries[entry]);
+    }
+}
+
+int profile_reset(void) {
+    ProfileEntry *entry;
+    int removed;
+
+    if (current < 0) {
+        profile_select(NULL);
+    }
+    entry = &entries[current];
+    habit_sketch_close();
+    entry->pending_len = 0;
+    clear_counts(entry);
+    entry->loaded = 0;
+
+    remove(entry->paths[PROFILE_INDEX]);
+    remove(entry->paths[PROFILE_SKETCH]);
+    removed = remove(entry->paths[PROFILE_LOG]) == 0;
+    if (entry->user[0] != '\0') {
+        remove_dir(entry->dir);
+    }
+    return removed ? 0 : 1;
+}
+
+void profile_store_close(void) {
+    int i;
+
+    if (entries == NULL) {
+        return;
+    }
+    profile_store_flush();
+    habit_sketch_close();
+    for (i = 0; i < entry_count; i++) {
+        save_counts(&entries[i]);
+        free_entry(&entries[i]);
+    }
+    free(entries);
+    free(slots);
+    entries = NULL;
+    slots = NULL;
+    entry_count = 0;
+    lru_head = -1;
+    lru_tail = -1;
+    current = -1;
+}
@@ -0,0 +1,262 @@
+// Semantic checks (declarations and uses)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lexer.h"
+#include "ast.h"
+#include "symbol_table.h"
+#include "semantic.h"
+#include "error_tracker.h"
+#include "threshold.h"
+#include "highlighter.h"
+
+static int *work_stack = NULL;
+static int work_count = 0;
+static int work_capacity = 0;
+
+static void push_work(int value) {
+    if (work_count == work_capacity) {
+        int new_capacity = work_capacity ? work_capacity * 2 : 64;
+        int *grown = realloc(work_stack, (size_t)new_capacity * sizeof(int));
+        if (grown == NULL) {
+            fprintf(stderr, "Error: Out of memory during semantic analysis\n");
+            exit(1);
+        }
+        work_stack = grown;
+        work_capacity = new_capacity;
+    }
+    work_stack[work_count++] = value;
+}
+
+static void report_semantic_error(ErrorCode code,
+                                  const char *message,
+                                  const char *name,
+                                  int line,
+                                  int column) {
+    Token token;
+
+    token.type = TOKEN_IDENTIFIER;
+    strncpy(token.lexeme, name, sizeof(token.lexeme) - 1);
+    token.lexeme[sizeof(token.lexeme) - 1] = '\0';
+    token.line = line;
+    token.column = column;
+
+    printf("Semantic error: %s '%s' at line %d, column %d\n",
+           message, token.lexeme, line, column);
+
+    error_tracker_log(code, &token);
+    if (threshold_check(code, &token)) {
+        printf("Notice: This appears to be a repeated (habitual) mistake.\n");
+    }
+    highlight_error(code, &token);
+}
+
+/* Bind a variable use to its declaration; returns the slot or -1 */
+static int resolve_use(const Ast *ast, SymbolTable *symbols, int name, int line, int column,
+                       int *errors) {
+    int id = symbol_intern(symbols, ast_name(ast, name));
+    int slot = symbol_lookup(symbols, id);
+
+    if (slot < 0) {
+        report_semantic_error(E_UNDECLARED_VARIABLE, "undeclared variable",
+                              ast_name(ast, name), line, column);
+        (*errors)++;
+    }
+    return slot;
+}
+
+/* Walk one expression tree with an explicit stack, resolving identifiers */
+static void resolve_expr(Ast *ast, SymbolTable *symbols, int root, int *errors) {
+    work_count = 0;
+    push_work(root);
+
+    while (work_count > 0) {
+        ExprNode *node = &ast->exprs[work_stack[--work_count]];
+
+        switch (node->kind) {
+            case EXPR_IDENTIFIER:
+                node->slot = resolve_use(ast, symbols, node->as.name,
+                                         node->line, node->column, errors);
+                if (node->slot >= 0) {
+                    symbols->symbols[node->slot].used = 1;
+                }
+                break;
+            case EXPR_NEGATE:
+                push_work(node->as.operand);
+                break;
+            case EXPR_BINARY:
+                /* Right first so the left operand is visited first */
+                push_work(node->as.bin.rhs);
+                push_work(node->as.bin.lhs);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+/* State of the check in progress (semantic_begin() .. semantic_end()) */
+static SymbolTable *check_symbols = NULL;
+static int check_errors = 0;
+static unsigned char *defined = NULL;      /* per intern id: function seen */
+static int defined_capacity = 0;
+static int *scope_ends = NULL;
+static int scope_capacity = 0;
+static int function_first_symbol = 0;
+
+static void *grow_zeroed(void *data, int *capacity, int needed, size_t elem_size) {
+    int new_capacity = *capacity ? *capacity : 64;
+    char *grown;
+
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+    grown = realloc(data, (size_t)new_capacity * elem_size);
+    if (grown == NULL) {
+        fprintf(stderr, "Error: Out of memory during semantic analysis\n");
+        exit(1);
+    }
+    memset(grown + (size_t)*capacity * elem_size, 0,
+           (size_t)(new_capacity - *capacity) * elem_size);
+    *capacity = new_capacity;
+    return grown;
+}
+
+static void warn_unused(int first) {
+    int i;
+
+    for (i = first; i < check_symbols->symbol_count; i++) {
+        const Symbol *symbol = &check_symbols->symbols[i];
+        if (!symbol->used) {
+            printf("Warning: variable '%s' declared at line %d, column %d is never used\n",
+                   symbol_spelling(check_symbols, symbol->name), symbol->line, symbol->column);
+        }
+    }
+}
+
+void semantic_begin(SymbolTable *symbols) {
+    check_symbols = symbols;
+    check_errors = 0;
+}
+
+void semantic_begin_function(Ast *ast, int function) {
+    const FunctionNode *node = &ast->functions[function];
+    int id = symbol_intern(check_symbols, ast_name(ast, node->name));
+
+    /* Function names live in their own namespace; flag duplicates */
+    if (id >= defined_capacity) {
+        defined = grow_zeroed(defined, &defined_capacity, id + 1, 1);
+    }
+    if (defined[id]) {
+        report_semantic_error(E_REDEFINED_FUNCTION, "redefined function",
+                              ast_name(ast, node->name), node->line, node->column);
+        check_errors++;
+    }
+    defined[id] = 1;
+
+    function_first_symbol = check_symbols->symbol_count;
+    symbol_push_scope(check_symbols); /* function body */
+}
+
+void semantic_check_statements(Ast *ast, int from, int to) {
+    SymbolTable *symbols = check_symbols;
+    int open_scopes = 0;
+    int i;
+
+    if (to - from >= scope_capacity) {
+        scope_ends = grow_zeroed(scope_ends, &scope_capacity, to - from + 1, sizeof(int));
+    }
+
+    for (i = from; i < to; i++) {
+        StmtNode *stmt = &ast->stmts[i];
+
+        /* Leave every body that ended before this statement */
+        while (open_scopes > 0 && scope_ends[open_scopes - 1] <= i) {
+            symbol_pop_scope(symbols);
+            open_scopes--;
+        }
+
+        switch (stmt->kind) {
+            case STMT_DECL: {
+                int id = symbol_intern(symbols, ast_name(ast, stmt->name));
+                stmt->slot = symbol_declare(symbols, id, stmt->line, stmt->column);
+                if (stmt->slot < 0) {
+                    report_semantic_error(E_REDECLARED_VARIABLE, "redeclared variable",
+                                          ast_name(ast, stmt->name),
+                                          stmt->line, stmt->column);
+                    check_errors++;
+                }
+                break;
+            }
+            case STMT_ASSIGN:
+                resolve_expr(ast, symbols, stmt->expr, &check_errors);
+                stmt->slot = resolve_use(ast, symbols, stmt->name,
+                                         stmt->line, stmt->column, &check_errors);
+                break;
+            case STMT_PRINT:
+                resolve_expr(ast, symbols, stmt->expr, &check_errors);
+                break;
+            case STMT_IF:
+                resolve_expr(ast, symbols, stmt->expr, &check_errors);
+                symbol_push_scope(symbols);
+                scope_ends[open_scopes++] = stmt->else_branch >= 0 ? stmt->else_branch : stmt->end;
+                break;
+            case STMT_ELSE:
+                symbol_push_scope(symbols);
+                scope_ends[open_scopes++] = stmt->end;
+                break;
+            case STMT_WHILE:
+                resolve_expr(ast, symbols, stmt->expr, &check_errors);
+                symbol_push_scope(symbols);
+                scope_ends[open_scopes++] = stmt->end;
+                break;
+            default:
+                break;
+        }
+    }
+
+    while (open_scopes > 0) {
+        symbol_pop_scope(symbols);
+        open_scopes--;
+    }
+}
+
+void semantic_end_function(int release) {
+    symbol_pop_scope(check_symbols);
+    if (release) {
+        /* Out of scope for good: report them now and reuse their slots */
+        warn_unused(function_first_symbol);
+        check_symbols->symbol_count = function_first_symbol;
+    }
+}
+
+int semantic_end(int report_unused) {
+    if (report_unused) {
+        warn_unused(0);
+    }
+
+    free(defined);
+    free(scope_ends);
+    free(work_stack);
+    defined = NULL;
+    scope_ends = NULL;
+    work_stack = NULL;
+    defined_capacity = scope_capacity = 0;
+    work_count = work_capacity = 0;
+    return check_errors;
+}
+
+int semantic_check(Ast *ast, SymbolTable *symbols) {
+    int i;
+
+    semantic_begin(symbols);
+    for (i = 0; i < ast->function_count; i++) {
+        const FunctionNode *function = &ast->functions[i];
+
+        semantic_begin_function(ast, i);
+        semantic_check_statements(ast, function->body_start, function->body_end);
+        semantic_end_function(0);
+    }
+    return semantic_end(1);
+}
@@ -0,0 +1,216 @@
+// Symbol table and identifier interning
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "symbol_table.h"
+
+#define INITIAL_BUCKETS 256
+
+static void *grow_array(void *data, int *capacity, size_t elem_size) {
+    int new_capacity = *capacity ? *capacity * 2 : 64;
+    void *grown = realloc(data, (size_t)new_capacity * elem_size);
+    if (grown == NULL) {
+        fprintf(stderr, "Error: Out of memory in symbol table\n");
+        exit(1);
+    }
+    *capacity = new_capacity;
+    return grown;
+}
+
+/* FNV-1a */
+static unsigned int hash_name(const char *name) {
+    unsigned int hash = 2166136261u;
+    while (*name) {
+        hash ^= (unsigned char)*name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void alloc_buckets(SymbolTable *table, int capacity) {
+    table->buckets = malloc((size_t)capacity * sizeof(int));
+    if (table->buckets == NULL) {
+        fprintf(stderr, "Error: Out of memory in symbol table\n");
+        exit(1);
+    }
+    memset(table->buckets, 0xff, (size_t)capacity * sizeof(int));
+    table->bucket_capacity = capacity;
+}
+
+/* Double the bucket array, reinserting ids from their cached hashes */
+static void rehash(SymbolTable *table) {
+    int *old = table->buckets;
+    int old_capacity = table->bucket_capacity;
+    int i;
+
+    alloc_buckets(table, old_capacity * 2);
+    for (i = 0; i < old_capacity; i++) {
+        if (old[i] >= 0) {
+            unsigned int mask = (unsigned int)table->bucket_capacity - 1;
+            unsigned int pos = table->hashes[old[i]] & mask;
+            while (table->buckets[pos] >= 0) {
+                pos = (pos + 1) & mask;
+            }
+            table->buckets[pos] = old[i];
+        }
+    }
+    free(old);
+}
+
+void symbol_table_init(SymbolTable *table) {
+    memset(table, 0, sizeof(*table));
+    alloc_buckets(table, INITIAL_BUCKETS);
+}
+
+void symbol_table_free(SymbolTable *table) {
+    free(table->buckets);
+    free(table->pool);
+    free(table->offsets);
+    free(table->hashes);
+    free(table->bindings);
+    free(table->symbols);
+    free(table->undo);
+    free(table->scope_marks);
+    memset(table, 0, sizeof(*table));
+}
+
+int symbol_intern(SymbolTable *table, const char *name) {
+    unsigned int hash = hash_name(name);
+    unsigned int mask = (unsigned int)table->bucket_capacity - 1;
+    unsigned int pos = hash & mask;
+    int probe = 1;
+    int id;
+
+    table->lookups++;
+    while (table->buckets[pos] >= 0) {
+        id = table->buckets[pos];
+        if (table->hashes[id] == hash && strcmp(table->pool + table->offsets[id], name) == 0) {
+            table->probes += (unsigned long long)probe;
+            if (probe > table->max_probe) {
+                table->max_probe = probe;
+            }
+            return id;
+        }
+        pos = (pos + 1) & mask;
+        probe++;
+    }
+    table->probes += (unsigned long long)probe;
+    if (probe > table->max_probe) {
+        table->max_probe = probe;
+    }
+
+    /* New spelling: copy it into the pool and give it the next id */
+    size_t len = strlen(name) + 1;
+    if (table->pool_len + len > table->pool_capacity) {
+        size_t new_capacity = table->pool_capacity ? table->pool_capacity : 1024;
+        char *grown;
+        while (table->pool_len + len > new_capacity) {
+            new_capacity *= 2;
+        }
+        grown = realloc(table->pool, new_capacity);
+        if (grown == NULL) {
+            fprintf(stderr, "Error: Out of memory in symbol table\n");
+            exit(1);
+        }
+        table->pool = grown;
+        table->pool_capacity = new_capacity;
+    }
+
+    if (table->intern_count == table->intern_capacity) {
+        int capacity = table->intern_capacity;
+        table->offsets = grow_array(table->offsets, &capacity, sizeof(int));
+        capacity = table->intern_capacity;
+        table->hashes = grow_array(table->hashes, &capacity, sizeof(unsigned int));
+        table->bindings = grow_array(table->bindings, &table->intern_capacity, sizeof(int));
+    }
+
+    id = table->intern_count++;
+    memcpy(table->pool + table->pool_len, name, len);
+    table->offsets[id] = (int)table->pool_len;
+    table->pool_len += len;
+    table->hashes[id] = hash;
+    table->bindings[id] = -1;
+    table->buckets[pos] = id;
+
+    /* Keep the load factor at or below 1/2 so probe sequences stay short */
+    if (table->intern_count * 2 > table->bucket_capacity) {
+        rehash(table);
+    }
+
+    return id;
+}
+
+const char *symbol_spelling(const SymbolTable *table, int name) {
+    return table->pool + table->offsets[name];
+}
+
+void symbol_push_scope(SymbolTable *table) {
+    if (table->depth == table->scope_capacity) {
+        table->scope_marks = grow_array(table->scope_marks, &table->scope_capacity, sizeof(int));
+    }
+    table->scope_marks[table->depth++] = table->undo_count;
+}
+
+void symbol_pop_scope(SymbolTable *table) {
+    int mark;
+
+    if (table->depth == 0) {
+        return;
+    }
+
+    mark = table->scope_marks[--table->depth];
+    while (table->undo_count > mark) {
+        ScopeUndo *entry = &table->undo[--table->undo_count];
+        table->bindings[entry->name] = entry->previous;
+    }
+}
+
+int symbol_declare(SymbolTable *table, int name, int line, int column) {
+    int current = table->bindings[name];
+    Symbol *symbol;
+
+    if (current >= 0 && table->symbols[current].depth == table->depth) {
+        return -1; /* already declared in this scope */
+    }
+
+    if (table->symbol_count == table->symbol_capacity) {
+        table->symbols = grow_array(table->symbols, &table->symbol_capacity, sizeof(Symbol));
+    }
+    if (table->undo_count == table->undo_capacity) {
+        table->undo = grow_array(table->undo, &table->undo_capacity, sizeof(ScopeUndo));
+    }
+
+    table->undo[table->undo_count].name = name;
+    table->undo[table->undo_count].previous = current;
+    table->undo_count++;
+
+    symbol = &table->symbols[table->symbol_count];
+    symbol->name = name;
+    symbol->line = line;
+    symbol->column = column;
+    symbol->depth = table->depth;
+    symbol->used = 0;
+
+    table->bindings[name] = table->symbol_count;
+    return table->symbol_count++;
+}
+
+int symbol_lookup(const SymbolTable *table, int name) {
+    return table->bindings[name];
+}
+
+void symbol_table_print_stats(const SymbolTable *table, FILE *out) {
+    double load = table->bucket_capacity
+                  ? (double)table->intern_count / table->bucket_capacity
+                  : 0.0;
+    double avg_probe = table->lookups
+                       ? (double)table->probes / (double)table->lookups
+                       : 0.0;
+
+    fprintf(out, "  symbols:     %d variables, %d distinct identifiers\n",
+            table->symbol_count, table->intern_count);
+    fprintf(out, "  hash table:  %d buckets, load %.2f, %llu lookups, "
+                 "avg probe %.2f, max probe %d\n",
+            table->bucket_capacity, load, table->lookups, avg_probe, table->max_probe);
+}
@@ -5,73 +5,17 @@
 #include <stdlib.h>
 #include "config.h"
 #include "lexer.h"
+#include "error_tracker.h"
+#include "habit_sketch.h"
+#include "profile_store.h"
 #include "threshold.h"
 
-static const char* token_type_to_string(TokenType type) {
-    switch (type) {
-        case TOKEN_KEYWORD:    return "TOKEN_KEYWORD";
-        case TOKEN_IDENTIFIER: return "TOKEN_IDENTIFIER";
-        case TOKEN_NUMBER:     return "TOKEN_NUMBER";
-        case TOKEN_SYMBOL:     return "TOKEN_SYMBOL";
-        case TOKEN_EOF:        return "TOKEN_EOF";
-        case TOKEN_UNKNOWN:    return "TOKEN_UNKNOWN";
-        default:               return "UNKNOWN";
+int threshold_check(ErrorCode code, const Token *actual_token) {
+    if (habit_sketch_enabled()) {
+        /* Never below the exact count, so no habit is missed */
+        return habit_sketch_estimate(code, actual_token) >= HABIT_THRESHOLD;
     }
-}
-
-static int matches_fingerprint(const char *line,
-                               const char *error_type,
-                               const char *expected_type,
-                               const char *expected_lexeme,
-                               const char *actual_type,
-                               const char *actual_lexeme,
-                               int line_no,
-                               int column_no) {
-    /* Format in file: error_type|expected_type|expected_lexeme|actual_type|actual_lexeme|line|column */
-    char expected_fingerprint[512];
-    snprintf(expected_fingerprint, sizeof(expected_fingerprint), "%s|%s|%s|%s|%s|%d|%d",
-             error_type ? error_type : "",
-             expected_type ? expected_type : "",
-             expected_lexeme ? expected_lexeme : "",
-             actual_type ? actual_type : "",
-             actual_lexeme ? actual_lexeme : "",
-             line_no,
-             column_no);
-
-    return (strcmp(line, expected_fingerprint) == 0);
-}
 
-int threshold_check(const char *error_type,
-                   const char *expected_type,
-                   const char *expected_lexeme,
-                   const Token *actual_token) {
-    FILE *profile = fopen("data/user_profile.dat", "r");
-    if (profile == NULL) {
-        return 0; /* No history file, not a repeated error */
-    }
-
-    const char *actual_type = token_type_to_string(actual_token->type);
-    const char *actual_lexeme = actual_token->lexeme;
-    
-    int count = 0;
-    char line[512];
-    
-    while (fgets(line, sizeof(line), profile) != NULL) {
-        /* Remove newline if present */
-        size_t len = strlen(line);
-        if (len > 0 && line[len - 1] == '\n') {
-            line[len - 1] = '\0';
-        }
-        
-        if (matches_fingerprint(line, error_type, expected_type, expected_lexeme,
-                                actual_type, actual_lexeme,
-                                actual_token->line, actual_token->column)) {
-            count++;
-        }
-    }
-    
-    fclose(profile);
-    
-    /* Return TRUE if count >= HABIT_THRESHOLD, FALSE otherwise */
-    return (count >= HABIT_THRESHOLD);
+    /* Exact counts kept by the profile cache; no log rescan per check */
+    return profile_count(code, actual_token) >= HABIT_THRESHOLD;
 }
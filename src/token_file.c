@@ -0,0 +1,357 @@
+// Binary token-stream dump and reload
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "lexer.h"
+#include "symbol_table.h"
+#include "token_file.h"
+
+#define TOKEN_FILE_MAGIC "HASCTOK"
+#define HEADER_SIZE (8 + 5 * 4)
+
+/* ---- Writing ---- */
+
+typedef struct {
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+} ByteBuffer;
+
+static void buffer_reserve(ByteBuffer *buffer, size_t extra) {
+    if (buffer->size + extra > buffer->capacity) {
+        size_t new_capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+        unsigned char *grown;
+
+        while (new_capacity < buffer->size + extra) {
+            new_capacity *= 2;
+        }
+        grown = realloc(buffer->data, new_capacity);
+        if (grown == NULL) {
+            fprintf(stderr, "Error: Out of memory while writing token file\n");
+            exit(1);
+        }
+        buffer->data = grown;
+        buffer->capacity = new_capacity;
+    }
+}
+
+static void put_bytes(ByteBuffer *buffer, const void *bytes, size_t count) {
+    buffer_reserve(buffer, count);
+    memcpy(buffer->data + buffer->size, bytes, count);
+    buffer->size += count;
+}
+
+static void put_varint(ByteBuffer *buffer, unsigned int value) {
+    buffer_reserve(buffer, 5);
+    while (value >= 0x80) {
+        buffer->data[buffer->size++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    buffer->data[buffer->size++] = (unsigned char)value;
+}
+
+static unsigned int zigzag(int value) {
+    return ((unsigned int)value << 1) ^ (unsigned int)(value < 0 ? -1 : 0);
+}
+
+static void put_u32(unsigned char *out, unsigned int value) {
+    out[0] = (unsigned char)value;
+    out[1] = (unsigned char)(value >> 8);
+    out[2] = (unsigned char)(value >> 16);
+    out[3] = (unsigned char)(value >> 24);
+}
+
+int token_file_write(const char *path, const TokenArray *array) {
+    ByteBuffer kinds = { NULL, 0, 0 };
+    ByteBuffer stream = { NULL, 0, 0 };
+    ByteBuffer pool = { NULL, 0, 0 };
+    unsigned char header[HEADER_SIZE];
+    int prev_line = 0;
+    int prev_column = 0;
+    int string_count;
+    int ok;
+    int i;
+    FILE *out;
+
+    /* Lexeme ids are the array's own intern ids, which the pool lists in order */
+    for (i = 0; i < array->count; i++) {
+        const PackedToken *token = &array->tokens[i];
+
+        put_bytes(&kinds, &token->type, 1);
+        put_varint(&stream, (unsigned int)token->lexeme);
+        if (token->line != prev_line) {
+            prev_column = 0;
+        }
+        put_varint(&stream, zigzag(token->line - prev_line));
+        put_varint(&stream, zigzag(token->column - prev_column));
+        prev_line = token->line;
+        prev_column = token->column;
+    }
+
+    string_count = array->lexemes.intern_count;
+    for (i = 0; i < string_count; i++) {
+        const char *spelling = symbol_spelling(&array->lexemes, i);
+        size_t len = strlen(spelling);
+        put_varint(&pool, (unsigned int)len);
+        put_bytes(&pool, spelling, len);
+    }
+
+    memcpy(header, TOKEN_FILE_MAGIC, 8);
+    put_u32(header + 8, TOKEN_FILE_VERSION);
+    put_u32(header + 12, (unsigned int)array->count);
+    put_u32(header + 16, (unsigned int)string_count);
+    put_u32(header + 20, (unsigned int)stream.size);
+    put_u32(header + 24, (unsigned int)pool.size);
+
+    out = fopen(path, "wb");
+    ok = out != NULL &&
+         fwrite(header, 1, sizeof(header), out) == sizeof(header) &&
+         fwrite(kinds.data, 1, kinds.size, out) == kinds.size &&
+         fwrite(stream.data, 1, stream.size, out) == stream.size &&
+         fwrite(pool.data, 1, pool.size, out) == pool.size;
+    if (out != NULL && fclose(out) != 0) {
+        ok = 0;
+    }
+
+    free(kinds.data);
+    free(stream.data);
+    free(pool.data);
+    return ok ? 0 : 1;
+}
+
+/* ---- Loading ---- */
+
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+} MappedFile;
+
+static int map_file(const char *path, MappedFile *map) {
+#ifdef _WIN32
+    LARGE_INTEGER size;
+
+    map->data = NULL;
+    map->mapping = NULL;
+    map->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, NULL);
+    if (map->file == INVALID_HANDLE_VALUE) {
+        return 1;
+    }
+    if (!GetFileSizeEx(map->file, &size) || size.QuadPart == 0) {
+        CloseHandle(map->file);
+        return 1;
+    }
+    map->size = (size_t)size.QuadPart;
+    map->mapping = CreateFileMappingA(map->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (map->mapping != NULL) {
+        map->data = MapViewOfFile(map->mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+    if (map->data == NULL) {
+        if (map->mapping != NULL) {
+            CloseHandle(map->mapping);
+        }
+        CloseHandle(map->file);
+        return 1;
+    }
+    return 0;
+#else
+    struct stat info;
+    void *data;
+
+    map->fd = open(path, O_RDONLY);
+    if (map->fd < 0) {
+        return 1;
+    }
+    if (fstat(map->fd, &info) != 0 || info.st_size == 0) {
+        close(map->fd);
+        return 1;
+    }
+    map->size = (size_t)info.st_size;
+    data = mmap(NULL, map->size, PROT_READ, MAP_PRIVATE, map->fd, 0);
+    if (data == MAP_FAILED) {
+        close(map->fd);
+        return 1;
+    }
+    map->data = data;
+    return 0;
+#endif
+}
+
+static void unmap_file(MappedFile *map) {
+#ifdef _WIN32
+    UnmapViewOfFile(map->data);
+    CloseHandle(map->mapping);
+    CloseHandle(map->file);
+#else
+    munmap((void *)map->data, map->size);
+    close(map->fd);
+#endif
+}
+
+typedef struct {
+    const unsigned char *pos;
+    const unsigned char *end;
+    int bad;
+} Reader;
+
+static unsigned int get_varint(Reader *reader) {
+    unsigned int value = 0;
+    int shift = 0;
+
+    while (reader->pos < reader->end && shift < 35) {
+        unsigned char byte = *reader->pos++;
+        value |= (unsigned int)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+        shift += 7;
+    }
+    reader->bad = 1;
+    return 0;
+}
+
+static int unzigzag(unsigned int value) {
+    return (int)(value >> 1) ^ -(int)(value & 1);
+}
+
+static unsigned int get_u32(const unsigned char *in) {
+    return (unsigned int)in[0] | ((unsigned int)in[1] << 8) |
+           ((unsigned int)in[2] << 16) | ((unsigned int)in[3] << 24);
+}
+
+/* Decode a mapped dump into `array`. Every length, id and position is
+ * checked, and every byte of each section must be used. */
+static int decode_tokens(const unsigned char *data, size_t size, TokenArray *array) {
+    unsigned int token_count, string_count, stream_bytes, pool_bytes;
+    const unsigned char *kinds;
+    int *ids = NULL;
+    Reader reader;
+    int line = 0;
+    int column = 0;
+    unsigned int i;
+
+    if (size < HEADER_SIZE || memcmp(data, TOKEN_FILE_MAGIC, 8) != 0 ||
+        get_u32(data + 8) != TOKEN_FILE_VERSION) {
+        return 1;
+    }
+    token_count = get_u32(data + 12);
+    string_count = get_u32(data + 16);
+    stream_bytes = get_u32(data + 20);
+    pool_bytes = get_u32(data + 24);
+    if (token_count == 0 || token_count > (unsigned int)0x7fffffff / sizeof(PackedToken) ||
+        (size_t)token_count + stream_bytes + pool_bytes != size - HEADER_SIZE) {
+        return 1;
+    }
+    /* Every string takes at least its length byte and is used by a token;
+     * check before sizing the id map by it */
+    if (string_count > pool_bytes || string_count > token_count) {
+        return 1;
+    }
+    kinds = data + HEADER_SIZE;
+
+    /* String pool: intern each lexeme, remembering its id in the array */
+    ids = malloc(((size_t)string_count + 1) * sizeof(*ids));
+    if (ids == NULL) {
+        fprintf(stderr, "Error: Out of memory while loading token file\n");
+        exit(1);
+    }
+    reader.pos = kinds + token_count + stream_bytes;
+    reader.end = reader.pos + pool_bytes;
+    reader.bad = 0;
+    for (i = 0; i < string_count; i++) {
+        char lexeme[sizeof(((Token *)0)->lexeme)];
+        unsigned int len = get_varint(&reader);
+
+        if (reader.bad || len >= sizeof(lexeme) || len > (size_t)(reader.end - reader.pos)) {
+            reader.bad = 1;
+            break;
+        }
+        memcpy(lexeme, reader.pos, len);
+        lexeme[len] = '\0';
+        ids[i] = symbol_intern(&array->lexemes, lexeme);
+        reader.pos += len;
+    }
+    if (reader.pos != reader.end) {
+        reader.bad = 1; /* pool bytes no string accounts for */
+    }
+
+    if (!reader.bad) {
+        array->tokens = malloc((size_t)token_count * sizeof(PackedToken));
+        if (array->tokens == NULL) {
+            fprintf(stderr, "Error: Out of memory while loading token file\n");
+            exit(1);
+        }
+        array->capacity = (int)token_count;
+        array->count = 0;
+
+        reader.pos = kinds + token_count;
+        reader.end = reader.pos + stream_bytes;
+        for (i = 0; i < token_count && !reader.bad; i++) {
+            PackedToken *token = &array->tokens[i];
+            unsigned int id = get_varint(&reader);
+            int line_delta = unzigzag(get_varint(&reader));
+            int column_delta = unzigzag(get_varint(&reader));
+
+            if (reader.bad || id >= string_count || kinds[i] > TOKEN_UNKNOWN) {
+                reader.bad = 1;
+                break;
+            }
+            if (line_delta != 0) {
+                column = 0;
+            }
+            /* Positions stay in [0, INT_MAX], so the sums cannot overflow */
+            if (line_delta < -line || line_delta > INT_MAX - line ||
+                column_delta < -column || column_delta > INT_MAX - column) {
+                reader.bad = 1;
+                break;
+            }
+            line += line_delta;
+            column += column_delta;
+
+            token->type = kinds[i];
+            token->lexeme = ids[id];
+            token->line = line;
+            token->column = column;
+            array->count++;
+        }
+        if (!reader.bad && (reader.pos != reader.end ||
+                            array->tokens[array->count - 1].type != TOKEN_EOF)) {
+            reader.bad = 1; /* trailing stream bytes, or no EOF token */
+        }
+    }
+
+    if (reader.bad) {
+        token_array_free(array);
+    }
+    free(ids);
+    return reader.bad;
+}
+
+int token_file_load(const char *path, TokenArray *array) {
+    MappedFile map;
+    int result;
+
+    if (map_file(path, &map) != 0) {
+        return 1;
+    }
+    result = decode_tokens(map.data, map.size, array);
+    unmap_file(&map);
+    return result;
+}
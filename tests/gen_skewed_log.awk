@@ -0,0 +1,11 @@
+# History generator for `make check-sketch`:
+#   awk -v mistakes=N -v top=C -f tests/gen_skewed_log.awk
+# prints habit log records for N distinct mistakes, the i-th logged
+# C/i times (Zipf), interleaved round by round
+BEGIN {
+    for (round = 0; round < top; round++) {
+        for (i = 1; i <= mistakes && round < int(top / i); i++) {
+            printf "1|1|%d|%d|x%d|skewed.c\n", i, i % 80, i
+        }
+    }
+}
@@ -0,0 +1,12 @@
+# Program generator for `make check-stream`:
+#   awk -v functions=N -v statements=M -f tests/gen_stream.awk
+# prints N functions, each with M assignment/if pairs in its body
+BEGIN {
+    for (f = 0; f < functions; f++) {
+        printf "int f%d() {\n    int x;\n    int y;\n    x = 1;\n", f
+        for (s = 0; s < statements; s++) {
+            printf "    y = x * 2 + %d;\n    if (y > 3) { x = y - 1; }\n", s
+        }
+        printf "    print(x + y);\n}\n"
+    }
+}
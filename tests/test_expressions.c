@@ -0,0 +1,9 @@
+int main() {
+    int a;
+    int b;
+    a = 1 + 2 * 3;
+    b = -(a - 4) / 2 <= 10 == 1;
+    if (a > b + 1) { }
+    while (a != 0) { a = a - 1; }
+    print((a + b) * (a - b));
+}
@@ -0,0 +1,22 @@
+int main() {
+    int i;
+    int j;
+    int sum;
+    int n;
+    n = 2000;
+    i = 0;
+    while (i < n) {
+        j = 0;
+        while (j < 1000) {
+            if (j / 7 * 7 == j) {
+                sum = sum + j;
+            } else {
+                sum = sum - 1;
+            }
+            j = j + 1;
+        }
+        i = i + 1;
+    }
+    print(sum);
+    print(i * j);
+}
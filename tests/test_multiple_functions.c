@@ -0,0 +1,11 @@
+int helper() {
+ int a;
+ a = 2;
+ print(a * 3);
+}
+
+int main() {
+ int x;
+ x = 1;
+ print(x);
+}
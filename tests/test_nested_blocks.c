@@ -0,0 +1,17 @@
+int main() {
+    int i;
+    int total;
+    i = 0;
+    total = 0;
+    while (i < 10) {
+        if (i / 2 * 2 == i) {
+            total = total + i;
+        } else {
+            if (i > 5) {
+                print(i);
+            }
+        }
+        i = i + 1;
+    }
+    print(total);
+}
@@ -0,0 +1,54 @@
+int main() {
+    int i;
+    int n;
+    int prev;
+    int fib;
+    int next;
+    int d;
+    int prime;
+    int primes;
+    int steps;
+    int x;
+    n = 90;
+    prev = 0;
+    fib = 1;
+    i = 1;
+    while (i < n) {
+        next = prev + fib;
+        prev = fib;
+        fib = next;
+        i = i + 1;
+    }
+    print(fib);
+    primes = 0;
+    n = 2;
+    while (n < 5000) {
+        prime = 1;
+        d = 2;
+        while (d * d <= n) {
+            if (n - n / d * d == 0) {
+                prime = 0;
+                d = n;
+            }
+            d = d + 1;
+        }
+        if (prime) {
+            primes = primes + 1;
+        }
+        n = n + 1;
+    }
+    print(primes);
+    x = 27;
+    steps = 0;
+    while (x != 1) {
+        if (x / 2 * 2 == x) {
+            x = x / 2;
+        } else {
+            x = 3 * x + 1;
+        }
+        steps = steps + 1;
+    }
+    print(steps);
+    print(-7 / 2);
+    print(-(prev - fib) * 3 - 1);
+}
@@ -0,0 +1,8 @@
+int main() {
+    int a;
+    a = 1;
+    if (a) ) {
+        print(a);
+    }
+    print(a);
+}
@@ -0,0 +1,12 @@
+int main() {
+    int a;
+    int b;
+    int a;
+    c = a + 1;
+    while (a < 3) {
+        int d;
+        d = a;
+        a = a + 1;
+    }
+    print(d);
+}